@@ -1,62 +1,116 @@
-/*
- * adc.c
- *
- *  Created on: Mar 8, 2016
- *      Author: barawn
- */
-
-#include "adc.h"
-#include "platform.h"
-
-ADC adc;
-
-#pragma NOINIT
-ADC::adc_calibration_t * ADC::adc_calib;
-#pragma NOINIT
-ADC::ref_calibration_t * ADC::ref_calib;
-
-void ADC::initialize() {
-	// Lots of initializing to do.
-	// Our channels are:
-	// A13
-	// A14
-	// A15
-	// A30
-	// A31
-	// Mux ON resistance is 4k max, capacitance is 15 pF.
-	// (4k * 9.7 * 15 pF) = ~500 ns.
-	// MODOSC is up to 5.4 MHz max. 4 ADC12CLK cycles is still fast enough for the rails.
-	// A13/A14/A15 are set up for 4 ADC12CLK cycles.
-	// The temperature sensor needs 30 us, so that's what we set up for.
-	// ADC12CLK is SMCLK, so we select 192 ADC12CLK cycles.
-
-	unsigned char *tmp;
-
-	tmp = platform_tag_find(TLV_ADC12CAL);
-	adc_calib = (adc_calibration_t *) tmp;
-
-	tmp = platform_tag_find(TLV_REFCAL);
-	ref_calib = (ref_calibration_t *) tmp;
-
-	// Just work with A30/A31 for now.
-
-	// ADC INITIALIZATION
-	ADC12CTL0 = ADC12ON | ADC12SHT1_0 | ADC12SHT0_7 | ADC12MSC;
-	ADC12CTL1 = ADC12CONSEQ_1 | ADC12SHP;
-	ADC12CTL3 = ADC12TCMAP | ADC12BATMAP;
-	// Set up our sequence.
-	ADC12MCTL0 = ADC12VRSEL_1 | ADC12INCH_30;
-	ADC12MCTL1 = ADC12VRSEL_1 | ADC12INCH_31 | ADC12EOS;
-	// Set up our reference.
-	while (REFCTL0 & REFGENBUSY);
-	// Don't need to enable the reference. It gets enabled automatically during ADC
-	// conversion.
-	REFCTL0 = REFVSEL_1;
-}
-
-#pragma vector=ADC12_VECTOR
-__interrupt void ADC12_Handler() {
-	ADC12IER0 = 0;
-	asm("	mov.b	#0x00, r4");
-	__bic_SR_register_on_exit(LPM0_bits);
-}
+/*
+ * adc.c
+ *
+ *  Created on: Mar 8, 2016
+ *      Author: barawn
+ */
+
+#include "adc.h"
+#include "platform.h"
+
+ADC adc;
+
+#pragma NOINIT
+ADC::adc_calibration_t * ADC::adc_calib;
+#pragma NOINIT
+ADC::ref_calibration_t * ADC::ref_calib;
+unsigned char ADC::last = 1;
+
+// Pin of each external channel, A0-A15, as port << 4 | bit. 0 is a
+// pin we can't have: P3.1/P3.2 (A13/A14) are the Twi bus.
+static const unsigned char adc_pins[16] = {
+		0x10, 0x11, 0x12, 0x13, 0x14, 0x15,		// P1.0-P1.5
+		0x23, 0x24,								// P2.3-P2.4
+		0x40, 0x41, 0x42, 0x43,					// P4.0-P4.3
+		0x30, 0x00, 0x00, 0x33					// P3.0, P3.3
+};
+
+//% \brief Switch an external channel's pin to its analog function.
+static void adc_select_pin(unsigned char pin) {
+	unsigned char bit;
+
+	bit = 1 << (pin & 0x7);
+	switch (pin >> 4) {
+	case 1: P1SEL0 |= bit; P1SEL1 |= bit; break;
+	case 2: P2SEL0 |= bit; P2SEL1 |= bit; break;
+	case 3: P3SEL0 |= bit; P3SEL1 |= bit; break;
+	case 4: P4SEL0 |= bit; P4SEL1 |= bit; break;
+	default: break;
+	}
+}
+
+void ADC::initialize() {
+	// Lots of initializing to do.
+	// Our channels are:
+	// A13
+	// A14
+	// A15
+	// A30
+	// A31
+	// Mux ON resistance is 4k max, capacitance is 15 pF.
+	// (4k * 9.7 * 15 pF) = ~500 ns.
+	// MODOSC is up to 5.4 MHz max. 4 ADC12CLK cycles is still fast enough for the rails.
+	// A13/A14/A15 are set up for 4 ADC12CLK cycles.
+	// The temperature sensor needs 30 us, so that's what we set up for.
+	// ADC12CLK is SMCLK, so we select 192 ADC12CLK cycles.
+
+	unsigned char *tmp;
+
+	tmp = platform_tag_find(TLV_ADC12CAL);
+	adc_calib = (adc_calibration_t *) tmp;
+
+	tmp = platform_tag_find(TLV_REFCAL);
+	ref_calib = (ref_calibration_t *) tmp;
+
+	// Just work with A30/A31 for now.
+
+	// ADC INITIALIZATION
+	ADC12CTL0 = ADC12ON | ADC12SHT1_0 | ADC12SHT0_7 | ADC12MSC;
+	ADC12CTL1 = ADC12CONSEQ_1 | ADC12SHP;
+	ADC12CTL3 = ADC12TCMAP | ADC12BATMAP;
+	// Set up our sequence.
+	ADC12MCTL0 = ADC12VRSEL_1 | ADC12INCH_30;
+	ADC12MCTL1 = ADC12VRSEL_1 | ADC12INCH_31 | ADC12EOS;
+	// Set up our reference.
+	while (REFCTL0 & REFGENBUSY);
+	// Don't need to enable the reference. It gets enabled automatically during ADC
+	// conversion.
+	REFCTL0 = REFVSEL_1;
+}
+
+//% \brief Whether a channel can be an extra channel.
+//%
+//% External channels A0-A15 whose pins are free, or the internal
+//% temperature sensor (A30) and AVCC/2 (A31).
+bool ADC::channel_usable(unsigned char channel) {
+	if (channel < 16) return (adc_pins[channel] != 0);
+	return (channel == 30 || channel == 31);
+}
+
+//% \brief Convert extra channels after the internal sensors.
+//%
+//% They go in MEM2 on, referenced to AVCC (their range is too high for
+//% the 2.0V reference). External channels have their pins switched to
+//% analog (and left that way). The sequence can only change with
+//% conversions disabled, so call this between conversions: convert()
+//% enables them. Channels must be channel_usable().
+void ADC::set_extra_channels(const unsigned char *channels, unsigned char count) {
+	unsigned char i;
+
+	if (count > EXTRA_MAX) count = EXTRA_MAX;
+	ADC12CTL0 &= ~ADC12ENC;
+	ADC12MCTL1 = ADC12VRSEL_1 | ADC12INCH_31;
+	for (i=0;i<count;i++) {
+		if (channels[i] < 16) adc_select_pin(adc_pins[channels[i]]);
+		(&ADC12MCTL0)[EXTRA_FIRST+i] = ADC12VRSEL_0 | (channels[i] & 0x1F);
+	}
+	last = EXTRA_FIRST + count - 1;
+	(&ADC12MCTL0)[last] |= ADC12EOS;
+}
+
+#pragma vector=ADC12_VECTOR
+__interrupt void ADC12_Handler() {
+	ADC12IER0 = 0;
+	asm("	mov.b	#0x00, r4");
+	__bic_SR_register_on_exit(LPM0_bits);
+}
@@ -1,211 +1,380 @@
-#include <msp430.h>
-#include "cmdline.h"
-#include "ui.h"
-#include "sensors.h"
-#include "info.h"
-#include "strprintf.h"
-
-CmdLine cmdline(ui.cmd_buffer);
-
-const char CmdLine::table[CmdLine::COMMAND_MAX/2-1][CmdLine::length+1] = {
-		"help ",
-		"versi",
-		"calib",
-		"set  ",
-		"info ",
-};
-
-const CmdLine::set_argument_t CmdLine::settables[CmdLine::SET_MAX/2] = {
-		{ "addre", &info.ipmi_address },
-		{ "seria", info.serial_number }
-};
-
-const char CmdLine::unknown_command_string[] = "Unknown command!\n\r";
-const char CmdLine::ver_string[] = "Version: testing\n\r";
-const char CmdLine::help_string[] = "Commands: help, version, calibrate, set, info\n\r";
-const char CmdLine::unknown_settable_string[] = "Set arguments: address, serial\n\r";
-
-void CmdLine::interpret() {
-
-	command = COMMAND_NONE;
-	if (buffer[0] == 0x0) return;
-	ui.logprintln("CMD> rec'd '%s'", buffer);
-	do {
-		unsigned int idx;
-		idx = (((unsigned int) command) >> 1) - 1;
-		if (compare(table[idx], buffer)) break;
-		command = (command_t) ((unsigned int) command + 2);
-	} while (command != COMMAND_MAX);
-}
-
-bool CmdLine::compare(const char *templ, const char *test) {
-	unsigned int i;
-	for (i=0;i<length;i++) {
-		// End of command?
-		if (templ[i] == ' ') return true;
-		// End of command buffer?
-		if (test[i] == 0x0) return true;
-		if (templ[i] != test[i]) return false;
-	}
-	return true;
-}
-
-bool CmdLine::handle() {
-	switch(__even_in_range(command, COMMAND_MAX)) {
-	case COMMAND_NONE:
-		if (!UART_BUSY()) return true;
-		else return false;
-	case COMMAND_HELP:
-		return handle_help();
-	case COMMAND_VERSION:
-		return handle_version();
-	case COMMAND_CALIBRATE:
-		return handle_calibrate();
-	case COMMAND_SET:
-		return handle_set();
-	case COMMAND_INFO:
-		return handle_info();
-	// Sleaze.
-	case COMMAND_MAX:
-		if (UART_BUSY()) return false;
-		UART_STRPUT(unknown_command_string);
-		command = COMMAND_NONE;
-		return false;
-	default:
-		__never_executed();
-	}
-}
-
-bool CmdLine::handle_info() {
-	static unsigned int state = 0;
-	if (UART_BUSY()) return false;
-
-	switch(__even_in_range(state, 6)) {
-	case 0: UART_STRPUT("Device Information:\n\r");
-			state = 2;
-			return false;
-	case 2: ui.strput("Serial Number: ");
-			ui.strnput(info.serial_number, 8);
-			ui.println("\n\r");
-			state = 4;
-			return false;
-	case 4: ui.println("IPMI Address: %X\n\r", info.ipmi_address);
-			state = 6;
-			return false;
-	case 6: ui.println("Firmware: %u.%u\n\r", info.fw_major, info.fw_minor);
-			state = 0;
-			command = COMMAND_NONE;
-			return false;
-	default:
-			__never_executed();
-	}
-}
-
-bool CmdLine::handle_set() {
-	unsigned int idx;
-	unsigned int swval;
-	char *arg;
-	char *val;
-	char *p;
-
-	arg = 0x0;
-	p = buffer;
-	if (UART_BUSY()) return false;
-	while (*p != ' ' && *p != 0x0) p++;
-	if (*p == 0x0) idx = SET_MAX;
-	else {
-		// Terminate the original command.
-		*p++ = 0x0;
-		arg = p;
-		for (idx=0;idx<SET_MAX/2;idx++) {
-			if (compare(settables[idx].name, arg)) {
-				p = arg;
-				// Find the value.
-				while (*p != ' ' && *p != 0x0) p++;
-				if (*p == 0x0) {
-					// Buffer ended before value.
-					idx = SET_MAX/2;
-					break;
-				}
-				// Terminate the argument.
-				*p++ = 0x0;
-				val = p;
-				break;
-			}
-		}
-	}
-handle_set_switch:
-	swval = idx << 1;
-	switch(__even_in_range(swval, SET_MAX)) {
-	// All settable 8 bit objects go here.
-	case SET_ADDRESS:
-		if (!isxdigit(val[0]) || !isxdigit(val[1])) {
-			idx = SET_MAX/2;
-			goto handle_set_switch;
-		} else {
-			unsigned char tmpval;
-			unsigned char *settable;
-			tmpval = atox(val[0]);
-			tmpval <<= 4;
-			tmpval |= atox(val[1]);
-
-			info.unlock();
-			settable = (unsigned char *) settables[idx].address;
-			*settable = tmpval;
-			info.lock();
-			ui.println("Set %s [%u] to %X\n\r", arg, idx, tmpval);
-			command = COMMAND_NONE;
-			return false;
-		}
-	case SET_SERIAL:
-		for (unsigned int i=0;i<8;i++) {
-			if (val[i] == 0x0) {
-				idx = SET_MAX/2;
-				goto handle_set_switch;
-			}
-		}
-		info.unlock();
-		p = (char *) settables[idx].address;
-		for (unsigned int i=0;i<8;i++) {
-			p[i] = val[i];
-		}
-		info.lock();
-		ui.print("Set %s [%u] to ", arg, idx);
-		ui.strnput((char *) settables[idx].address, 8);
-		ui.println("\n\r");
-		command = COMMAND_NONE;
-		return false;
-	case SET_MAX:
-		UART_STRPUT(unknown_settable_string);
-		command = COMMAND_NONE;
-		return false;
-	default:
-		__never_executed();
-	}
-}
-
-bool CmdLine::handle_calibrate() {
-	if (UART_BUSY()) return false;
-	sensors.calibrate();
-	ui.println("Calibration:\n\rTemp: m %u b %u\n\rVolt: m %u b %u\n\r",
-				info.calibration.uc_temp_m,
-				info.calibration.uc_temp_b,
-				info.calibration.uc_volt_m,
-				info.calibration.uc_volt_b);
-	command = COMMAND_NONE;
-	return false;
-}
-
-bool CmdLine::handle_help() {
-	if (UART_BUSY()) return false;
-	UART_STRPUT(help_string);
-	command = COMMAND_NONE;
-	return false;
-}
-
-bool CmdLine::handle_version() {
-	if (UART_BUSY()) return false;
-	UART_STRPUT(ver_string);
-	command = COMMAND_NONE;
-	return false;
-}
+#include <msp430.h>
+#include "cmdline.h"
+#include "ui.h"
+#include "sensors.h"
+#include "info.h"
+#include "ipmi_device_specific.h"
+#include "ipmiv2.h"
+#include "latency.h"
+#include "strprintf.h"
+
+CmdLine cmdline(ui.cmd_buffer);
+
+const char CmdLine::table[CmdLine::COMMAND_MAX/2-1][CmdLine::length+1] = {
+		"help ",
+		"versi",
+		"calib",
+		"set  ",
+		"info ",
+		"stats",
+		"laten",
+		"senso",
+};
+
+const CmdLine::set_argument_t CmdLine::settables[CmdLine::SET_MAX/2] = {
+		{ "addre", &info.ipmi_address },
+		{ "seria", info.serial_number },
+		{ "backo", &info.ipmi_backoff_max },
+		{ "retry", &info.ipmi_retry_budget },
+		{ "messa", &info.ipmi_message_max }
+};
+
+const char CmdLine::unknown_command_string[] = "Unknown command!\n\r";
+const char CmdLine::ver_string[] = "Version: testing\n\r";
+const char CmdLine::help_string[] = "Commands: help, version, calibrate, set, info, stats, latency, sensor\n\r";
+const char CmdLine::unknown_settable_string[] = "Set arguments: address, serial, backoff, retry, message\n\r";
+const char CmdLine::sensor_usage_string[] = "Usage: sensor [<slot> <offset> <hex bytes>]\n\r";
+
+void CmdLine::interpret() {
+
+	command = COMMAND_NONE;
+	if (buffer[0] == 0x0) return;
+	ui.logprintln("CMD> rec'd '%s'", buffer);
+	do {
+		unsigned int idx;
+		idx = (((unsigned int) command) >> 1) - 1;
+		if (compare(table[idx], buffer)) break;
+		command = (command_t) ((unsigned int) command + 2);
+	} while (command != COMMAND_MAX);
+}
+
+bool CmdLine::compare(const char *templ, const char *test) {
+	unsigned int i;
+	for (i=0;i<length;i++) {
+		// End of command?
+		if (templ[i] == ' ') return true;
+		// End of command buffer?
+		if (test[i] == 0x0) return true;
+		if (templ[i] != test[i]) return false;
+	}
+	return true;
+}
+
+bool CmdLine::handle() {
+	switch(__even_in_range(command, COMMAND_MAX)) {
+	case COMMAND_NONE:
+		if (!UART_BUSY()) return true;
+		else return false;
+	case COMMAND_HELP:
+		return handle_help();
+	case COMMAND_VERSION:
+		return handle_version();
+	case COMMAND_CALIBRATE:
+		return handle_calibrate();
+	case COMMAND_SET:
+		return handle_set();
+	case COMMAND_INFO:
+		return handle_info();
+	case COMMAND_STATS:
+		return handle_stats();
+	case COMMAND_LATENCY:
+		return handle_latency();
+	case COMMAND_SENSOR:
+		return handle_sensor();
+	// Sleaze.
+	case COMMAND_MAX:
+		if (UART_BUSY()) return false;
+		UART_STRPUT(unknown_command_string);
+		command = COMMAND_NONE;
+		return false;
+	default:
+		__never_executed();
+	}
+}
+
+bool CmdLine::handle_info() {
+	static unsigned int state = 0;
+	if (UART_BUSY()) return false;
+
+	switch(__even_in_range(state, 6)) {
+	case 0: UART_STRPUT("Device Information:\n\r");
+			state = 2;
+			return false;
+	case 2: ui.strput("Serial Number: ");
+			ui.strnput(info.serial_number, 8);
+			ui.println("\n\r");
+			state = 4;
+			return false;
+	case 4: ui.println("IPMI Address: %X\n\r", info.ipmi_address);
+			state = 6;
+			return false;
+	case 6: ui.println("Firmware: %u.%u\n\r", info.fw_major, info.fw_minor);
+			state = 0;
+			command = COMMAND_NONE;
+			return false;
+	default:
+			__never_executed();
+	}
+}
+
+bool CmdLine::handle_stats() {
+	static unsigned int idx = 0;
+	if (UART_BUSY()) return false;
+
+	// One line per call: header, then each counter.
+	if (idx == 0) {
+		UART_STRPUT("IPMB Statistics:\n\r");
+		idx++;
+		return false;
+	}
+	ui.println("%s: %u\n\r", ipmi.stats_names[idx-1], ((unsigned int *) &ipmi.stats)[idx-1]);
+	if (idx++ == ipmi.NUM_STATS) {
+		idx = 0;
+		command = COMMAND_NONE;
+	}
+	return false;
+}
+
+bool CmdLine::handle_latency() {
+	static unsigned int idx = 0;
+	const Latency::latency_histogram_t *h;
+	unsigned long bound;
+	unsigned int count;
+	unsigned int sum;
+	unsigned char median;
+	unsigned char max;
+	unsigned char b;
+
+	if (UART_BUSY()) return false;
+	// One line per call: header, one row per bucket for the phases,
+	// then a summary line per command.
+	if (idx == 0) {
+		UART_STRPUT("Latency (us):   queued handling transmit total\n\r");
+		idx++;
+		return false;
+	}
+	if (idx <= latency.LATENCY_BUCKETS) {
+		b = idx - 1;
+		bound = (unsigned long) latency.US_PER_COUNT << b;
+		if (b == latency.LATENCY_BUCKETS - 1) ui.print(">=%n: ", bound >> 1);
+		else ui.print("< %n: ", bound);
+		ui.println("%u %u %u %u\n\r",
+				   latency.data.phase[0].bucket[b],
+				   latency.data.phase[1].bucket[b],
+				   latency.data.phase[2].bucket[b],
+				   latency.data.phase[3].bucket[b]);
+		idx++;
+		return false;
+	}
+	b = idx - latency.LATENCY_BUCKETS - 1;
+	if (b < latency.LATENCY_COMMANDS && latency.data.command_key[b][0] != 0xFF) {
+		h = &latency.data.command[b];
+		count = 0;
+		max = 0;
+		for (median=0;median<latency.LATENCY_BUCKETS;median++) {
+			count += h->bucket[median];
+			if (h->bucket[median]) max = median;
+		}
+		sum = 0;
+		for (median=0;median<latency.LATENCY_BUCKETS-1;median++) {
+			sum += h->bucket[median];
+			if (sum >= (count+1)/2) break;
+		}
+		ui.println("%X/%X: n=%u median<%n max<%n\n\r",
+				   latency.data.command_key[b][0],
+				   latency.data.command_key[b][1],
+				   count,
+				   (unsigned long) latency.US_PER_COUNT << median,
+				   (unsigned long) latency.US_PER_COUNT << max);
+		idx++;
+		return false;
+	}
+	idx = 0;
+	command = COMMAND_NONE;
+	return false;
+}
+
+bool CmdLine::handle_sensor() {
+	static unsigned int idx = 0;
+	const IPMI_Device::ipmi_sensor_table_entry_t *entry;
+	unsigned char bytes[32];
+	unsigned char rsp[2];
+	unsigned char count;
+	unsigned char slot;
+	char *p;
+
+	if (UART_BUSY()) return false;
+	p = buffer;
+	while (*p != ' ' && *p != 0x0) p++;
+	if (*p != 0x0) {
+		// Write: slot, offset, then the data. All hex bytes.
+		count = 0;
+		while (*p != 0x0 && count < sizeof(bytes)) {
+			if (*p == ' ') {
+				p++;
+				continue;
+			}
+			if (!isxdigit(p[0]) || !isxdigit(p[1])) {
+				count = 0;
+				break;
+			}
+			bytes[count] = atox(p[0]) << 4;
+			bytes[count++] |= atox(p[1]);
+			p += 2;
+		}
+		command = COMMAND_NONE;
+		if (count >= 3) {
+			thisDevice.write_sensor_table_entry(bytes[0], bytes[1], bytes + 2, count - 2, rsp);
+			if (rsp[0] == IPMI::IPMI_COMPLETION_OK) {
+				ui.println("Wrote %u bytes to sensor slot %u\n\r", rsp[1], bytes[0]);
+				return false;
+			}
+		}
+		UART_STRPUT(sensor_usage_string);
+		return false;
+	}
+	// List: one line per call, header then each slot.
+	if (idx == 0) {
+		UART_STRPUT("Sensor table: slot sensor source channel reg bytes >> (raw-offset)*mul>>shift\n\r");
+		idx++;
+		return false;
+	}
+	slot = idx - 1;
+	entry = &thisDevice.sensor_table[slot];
+	if (!thisDevice.sensor_table_present(slot)) {
+		ui.println("%u: unused\n\r", slot);
+	} else {
+		ui.print("%u: %u %u %X %X %u %u (%u-%i)*%i>>%u ",
+				 slot,
+				 entry->sdr.key[2],
+				 entry->source,
+				 entry->channel,
+				 entry->reg,
+				 entry->raw_bytes,
+				 entry->raw_shift,
+				 sensors.table_values[slot],
+				 (int) (entry->offset_lsb | (entry->offset_msb << 8)),
+				 (int) (entry->mul_lsb | (entry->mul_msb << 8)),
+				 entry->shift);
+		ui.strnput((const char *) entry->sdr.id, sizeof(entry->sdr.id));
+		ui.println("\n\r");
+	}
+	if (idx++ == IPMI_Device::TABLE_SENSORS) {
+		idx = 0;
+		command = COMMAND_NONE;
+	}
+	return false;
+}
+
+bool CmdLine::handle_set() {
+	unsigned int idx;
+	unsigned int swval;
+	char *arg;
+	char *val;
+	char *p;
+
+	arg = 0x0;
+	p = buffer;
+	if (UART_BUSY()) return false;
+	while (*p != ' ' && *p != 0x0) p++;
+	if (*p == 0x0) idx = SET_MAX;
+	else {
+		// Terminate the original command.
+		*p++ = 0x0;
+		arg = p;
+		for (idx=0;idx<SET_MAX/2;idx++) {
+			if (compare(settables[idx].name, arg)) {
+				p = arg;
+				// Find the value.
+				while (*p != ' ' && *p != 0x0) p++;
+				if (*p == 0x0) {
+					// Buffer ended before value.
+					idx = SET_MAX/2;
+					break;
+				}
+				// Terminate the argument.
+				*p++ = 0x0;
+				val = p;
+				break;
+			}
+		}
+	}
+handle_set_switch:
+	swval = idx << 1;
+	switch(__even_in_range(swval, SET_MAX)) {
+	// All settable 8 bit objects go here.
+	case SET_BACKOFF:
+	case SET_RETRY:
+	case SET_MESSAGE:
+	case SET_ADDRESS:
+		if (!isxdigit(val[0]) || !isxdigit(val[1])) {
+			idx = SET_MAX/2;
+			goto handle_set_switch;
+		} else {
+			unsigned char tmpval;
+			unsigned char *settable;
+			tmpval = atox(val[0]);
+			tmpval <<= 4;
+			tmpval |= atox(val[1]);
+
+			info.unlock();
+			settable = (unsigned char *) settables[idx].address;
+			*settable = tmpval;
+			info.lock();
+			ui.println("Set %s [%u] to %X\n\r", arg, idx, tmpval);
+			command = COMMAND_NONE;
+			return false;
+		}
+	case SET_SERIAL:
+		for (unsigned int i=0;i<8;i++) {
+			if (val[i] == 0x0) {
+				idx = SET_MAX/2;
+				goto handle_set_switch;
+			}
+		}
+		info.unlock();
+		p = (char *) settables[idx].address;
+		for (unsigned int i=0;i<8;i++) {
+			p[i] = val[i];
+		}
+		info.lock();
+		thisDevice.update_fru_serial();
+		ui.print("Set %s [%u] to ", arg, idx);
+		ui.strnput((char *) settables[idx].address, 8);
+		ui.println("\n\r");
+		command = COMMAND_NONE;
+		return false;
+	case SET_MAX:
+		UART_STRPUT(unknown_settable_string);
+		command = COMMAND_NONE;
+		return false;
+	default:
+		__never_executed();
+	}
+}
+
+bool CmdLine::handle_calibrate() {
+	if (UART_BUSY()) return false;
+	sensors.calibrate();
+	ui.println("Calibration:\n\rTemp: m %u b %u\n\rVolt: m %u b %u\n\r",
+				info.calibration.uc_temp_m,
+				info.calibration.uc_temp_b,
+				info.calibration.uc_volt_m,
+				info.calibration.uc_volt_b);
+	command = COMMAND_NONE;
+	return false;
+}
+
+bool CmdLine::handle_help() {
+	if (UART_BUSY()) return false;
+	UART_STRPUT(help_string);
+	command = COMMAND_NONE;
+	return false;
+}
+
+bool CmdLine::handle_version() {
+	if (UART_BUSY()) return false;
+	UART_STRPUT(ver_string);
+	command = COMMAND_NONE;
+	return false;
+}
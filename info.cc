@@ -1,11 +1,17 @@
-#include "info.h"
-
-Info info;
-
-#pragma DATA_SECTION(".infoB")
-unsigned char Info::ipmi_address;
-#pragma DATA_SECTION(".infoB")
-char Info::serial_number[8];
-#pragma DATA_SECTION(".infoC")
-Sensors::sensor_calibration_t Info::calibration;
-
+#include "info.h"
+
+Info info;
+
+#pragma DATA_SECTION(".infoB")
+unsigned char Info::ipmi_address;
+#pragma DATA_SECTION(".infoB")
+char Info::serial_number[8];
+#pragma DATA_SECTION(".infoB")
+unsigned char Info::ipmi_backoff_max;
+#pragma DATA_SECTION(".infoB")
+unsigned char Info::ipmi_retry_budget;
+#pragma DATA_SECTION(".infoB")
+unsigned char Info::ipmi_message_max;
+#pragma DATA_SECTION(".infoC")
+Sensors::sensor_calibration_t Info::calibration;
+
@@ -1,39 +1,49 @@
-/*
- * info.h
- *
- *  Created on: Feb 21, 2016
- *      Author: barawn
- */
-
-#ifndef INFO_H_
-#define INFO_H_
-
-#include <msp430.h>
-#include "sensors.h"
-
-//% \brief Informational class.
-//%
-//% The Info class contains general information/parameters, including the IPMI address.
-class Info {
-public:
-	Info() {}
-	static unsigned char ipmi_address;
-	static char serial_number[8];
-	static Sensors::sensor_calibration_t calibration;
-
-	const unsigned char fw_major = 0x01;
-	const unsigned char fw_minor = 0x00;
-
-	static inline void unlock() {
-		MPUCTL0_H = 0xA5;
-		MPUSAM |= MPUSEGIWE;
-	}
-	static inline void lock() {
-		MPUSAM &= ~MPUSEGIWE;
-		MPUCTL0_H = 0x00;
-	}
-};
-
-extern Info info;
-
-#endif /* INFO_H_ */
+/*
+ * info.h
+ *
+ *  Created on: Feb 21, 2016
+ *      Author: barawn
+ */
+
+#ifndef INFO_H_
+#define INFO_H_
+
+#include <msp430.h>
+#include "sensors.h"
+
+//% \brief Informational class.
+//%
+//% The Info class contains general information/parameters, including the IPMI address.
+class Info {
+public:
+	Info() {}
+	static unsigned char ipmi_address;
+	static char serial_number[8];
+	static Sensors::sensor_calibration_t calibration;
+	// IPMB retry policy. 0 (or erased, 0xFF) means use the default.
+	static unsigned char ipmi_backoff_max;
+	static unsigned char ipmi_retry_budget;
+	// Longest IPMB message we send, counting the slave address. 0 (or
+	// erased, 0xFF) means IPMB's 32 bytes: only set it higher (up to
+	// 66) if the BMC takes longer messages.
+	static unsigned char ipmi_message_max;
+
+	const unsigned char fw_major = 0x01;
+	const unsigned char fw_minor = 0x00;
+
+	// Write access to the info segment (.infoB/.infoC). Nothing else
+	// needs it: PERSISTENT variables are in the MPU's read/write
+	// segment.
+	static inline void unlock() {
+		MPUCTL0_H = 0xA5;
+		MPUSAM |= MPUSEGIWE;
+	}
+	static inline void lock() {
+		MPUSAM &= ~MPUSEGIWE;
+		MPUCTL0_H = 0x00;
+	}
+};
+
+extern Info info;
+
+#endif /* INFO_H_ */
@@ -1,229 +1,874 @@
-#include <stdlib.h>
-#include <string.h>
-#include "ipmi_device_specific.h"
-#include "info.h"
-#include "sensors.h"
-
-IPMI_Device thisDevice;
-
-/*
- *
- * These are standard responses. Nothing here should have to be
- * changed.
- *
- */
-
-//< \brief Get Device ID response.
-unsigned char *IPMI_Device::copy_device_id(unsigned char *target) {
-	*target++ = IPMI::IPMI_COMPLETION_OK;
-
-	memcpy(target, &device_id, sizeof(device_id));
-	target += sizeof(device_id);
-	return target;
-}
-
-//< \brief Get SDR Info response.
-unsigned char *IPMI_Device::copy_sdr_info(unsigned char operation,
-										  unsigned char *target) {
-	*target++ = IPMI::IPMI_COMPLETION_OK;
-	// If 'operation' = 1, we return the total count (all LUNs).
-	// We only have 1 LUN, so it's always the same.
-	*target++ = NUM_SDRS;
-	*target++ = SDR_FLAGS;
-	return target;
-}
-
-//< \brief Reserve Device SDR Repository response.
-unsigned char *IPMI_Device::reserve_device_sdr_repository(unsigned char *target) {
-	*target++ = IPMI::IPMI_COMPLETION_OK;
-	*target++ = 0x01;
-	*target++ = 0x00;
-	return target;
-}
-
-//< \brief Get Device SDR response.
-unsigned char *IPMI_Device::copy_sdr(unsigned int sdr,
-									 unsigned char offset,
-									 unsigned char bytes,
-									 unsigned char *target) {
-	ipmi_sdr_header_t *hdr;
-	const unsigned char *this_sdr;
-	unsigned char *p;
-
-	p = target + 1;
-	*target = IPMI::IPMI_COMPLETION_OK;
-	// We need 3 bytes for next record ID + completion code
-	const unsigned char COPY_MAX = IPMI::TX_BUFFER_MAX - IPMI::IPMI_MIN_MESSAGE_LENGTH - 3;
-	// Does the SDR exist?
-	if (sdr >= NUM_SDRS) {
-		// No.
-		*target = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
-		return p;
-	}
-	// Yes.
-	hdr = (ipmi_sdr_header_t *) sdrs[sdr];
-	this_sdr = sdrs[sdr];
-
-	// Check if the offset goes too far. Record length is number
-	// of following bytes.
-	if (offset >= hdr->record_length + sizeof(ipmi_sdr_header_t)) {
-		*target = IPMI::IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE;
-		return p;
-	}
-	// It's a valid offset.
-	if (bytes == 0xFF) {
-		// Read Entire Record.
-		bytes = hdr->record_length + sizeof(ipmi_sdr_header_t) - offset;
-	} else {
-		if (offset + bytes > hdr->record_length + sizeof(ipmi_sdr_header_t)) {
-			*target = IPMI::IPMI_COMPLETION_REQUEST_DATA_TRUNCATED;
-			bytes = hdr->record_length + sizeof(ipmi_sdr_header_t) - offset;
-		}
-	}
-	if (bytes > COPY_MAX) {
-		*target = IPMI::IPMI_COMPLETION_CANNOT_RETURN_NUMBER_OF_BYTES;
-		return p;
-	}
-	if (sdr == NUM_SDRS-1) {
-		*p++ = 0xFF;
-		*p++ = 0xFF;
-	} else {
-		unsigned int id;
-		id = hdr->record_id_lsb + (hdr->record_id_msb << 8);
-		id++;
-		*p++ = id & 0xFF;
-		*p++ = (id >> 8) & 0xFF;
-	}
-	this_sdr += offset;
-	memcpy(p, this_sdr, bytes);
-	p += bytes;
-	return p;
-}
-
-/*
- *
- * Device-Specific data structures and functions.
- *
- */
-
-//% \brief Get Sensor Reading response.
-unsigned char *IPMI_Device::copy_sensor_reading(unsigned char number, unsigned char *target) {
-	int tmp;
-
-	if (number > NUM_SDRS-1) {
-		*target++ = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
-		return target;
-	}
-
-	*target++ = IPMI::IPMI_COMPLETION_OK;
-	switch(__even_in_range(number<<1, (NUM_SDRS-1)<<1)) {
-	case 0:
-		// Temperature sensor.
-		tmp = sensors.cal_values[0];
-		// Divide by 4.
-		tmp = tmp >> 2;
-		// Bound range.
-		if (tmp < -128) tmp = -128;
-		if (tmp > 127) tmp = 127;
-		*target++ = tmp & 0xFF;
-		break;
-	case 2:
-		// Voltage sensor.
-		tmp = sensors.cal_values[1];
-		// Subtract nominal.
-		tmp -= 3300;
-		// Divide by 4.
-		tmp = tmp >> 2;
-		// Bound range.
-		if (tmp < -128) tmp = -128;
-		if (tmp > 127) tmp = 127;
-		*target++ = tmp & 0xFF;
-		break;
-	}
-	// State.
-	*target++ = 0x40;
-	// Thresholds.
-	*target++ = 0x00;
-	return target;
-}
-
-// Primary thing we need to do is loop through the SDRs and assign our IPMI address to them.
-void IPMI_Device::initialize() {
-	unsigned int i;
-	ipmi_sensor_record_t *sensor;
-	ipmi_mc_locator_record_t *mc;
-
-	mc = (ipmi_mc_locator_record_t *) sdrs[0];
-	mc->key[0] = info.ipmi_address;
-	for (i=1;i<NUM_SDRS;i++) {
-		sensor = (ipmi_sensor_record_t *) sdrs[i];
-		sensor->key[0] = info.ipmi_address;
-		sensor->key[1] = 0;
-		sensor->key[2] = i-1;
-	}
-	// Copy calibration.
-	sensor = (ipmi_sensor_record_t *) sdrs[1];
-	sensor->description.m = info.calibration.uc_temp_m << 2;
-}
-
-#pragma PERSISTENT
-IPMI_Device::ipmi_device_id_t IPMI_Device::device_id = {
-		.id = 0x01,
-		.revision = (1<<7) | 0x00,
-		.ipmi = 0x51,
-		.capabilities = IPMI_SENSOR_DEVICE,
-		.manufacturer = { (IANA_ENTERPRISE_ID_OHIO_STATE>> 0) & 0xFF,
-						  (IANA_ENTERPRISE_ID_OHIO_STATE>> 8) & 0xFF,
-						  (IANA_ENTERPRISE_ID_OHIO_STATE>>16) & 0xFF },
-		.product = { 0x00, 0x80 }
-};
-
-#pragma PERSISTENT
-IPMI_Device::ipmi_mc_locator_record_t mc_locator_record = {
-		.hdr = { 0x00, 0x00, 0x51, 0x12, sizeof(IPMI_Device::ipmi_mc_locator_record_t)-sizeof(IPMI_Device::ipmi_sdr_header_t)},
-		.capabilities = IPMI_SENSOR_DEVICE,
-		.entity_id = 0x11,
-		.entity_instance = 0x00,
-		.id_type_length = 0xC8,
-		.id = { 'T','I','S','C',' ','V','2',' ' },
-};
-// Divide temp by 4, and scale up 'b' by 4.
-// Result is 10^-2, and b = 30, with exponent 2.
-#pragma PERSISTENT
-IPMI_Device::ipmi_sensor_record_t mc_temp_sensor = {
-		.hdr = { 0x01, 0x00, 0x51, 0x01, (sizeof(IPMI_Device::ipmi_sensor_record_t) - sizeof(IPMI_Device::ipmi_sdr_header_t)) },
-		.entity_id = 0x11,
-		.entity_instance = 0x00,
-		.sensor_initialization = 0x1,
-		.sensor_capabilities = 0x03,
-		.sensor_type = 0x01,
-		.event_reading_type_code = 0x01,
-		.description = { .units = { 0x40, 0x01, 0x00 }, .b = 30, .rexp_bexp = 0xE2 },
-		.id_type_length = 0xC8,
-		.id = { 'M', 'S', 'P', '_', 'T', 'E', 'M', 'P' },
-};
-// Our units are millivolts. To range down to below 3V, though, we want:
-// 3.3V - 512 mV + 512 mV , so a total range of 1024 mV, with 256 values.
-// So m = 4, and we divide our inputs by 4.
-// Result is 10^-3. b = 33, with exponent 2.
-#pragma PERSISTENT
-IPMI_Device::ipmi_sensor_record_t mc_volt_sensor = {
-		.hdr = { 0x02, 0x00, 0x51, 0x01, (sizeof(IPMI_Device::ipmi_sensor_record_t) - sizeof(IPMI_Device::ipmi_sdr_header_t)) },
-		.entity_id = 0x11,
-		.entity_instance = 0x00,
-		.sensor_initialization = 0x1,
-		.sensor_capabilities = 0x03,
-		.sensor_type = 0x02,
-		.event_reading_type_code = 0x01,
-		.description = { .units = { 0x40, 0x04, 0x00 }, .m = 4, .b = 33, .rexp_bexp = 0xD2 },
-		.id_type_length = 0xC8,
-		.id = { 'M', 'S', 'P', '_', 'V', 'O', 'L', 'T' },
-};
-
-#pragma PERSISTENT
-unsigned char *IPMI_Device::sdrs[IPMI_Device::NUM_SDRS] = {
-		(unsigned char *) &mc_locator_record,
-		(unsigned char *) &mc_temp_sensor,
-		(unsigned char *) &mc_volt_sensor
-};
-
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "ipmi_device_specific.h"
+#include "ipmi_sdr.h"
+#include "info.h"
+#include "sensors.h"
+#include "adc.h"
+
+IPMI_Device thisDevice;
+
+// Sensor conversions. These generate the SDR M/B/exponents and the
+// reading encoders, so the two can't disagree.
+// Temperature is in centidegrees: -40 C to 120 C.
+typedef IPMI_SDR_Linear<-4000, 12000, -2> mc_temp_linear;
+// Voltage is in millivolts: 2.8 V to 3.8 V.
+typedef IPMI_SDR_Linear<2800, 3800, -3> mc_volt_linear;
+
+// Sensor kinds: conversion, unit, thresholds and hysteresis.
+// Thresholds: 70 C, 80 C, 85 C. The lower ones aren't readable.
+typedef IPMI_SDR_Kind<mc_temp_linear, IPMI_SDR_UNIT_DEGREES_C,
+					  8500, 8000, 7000, -4000, -4000, -4000, 2, 2> mc_temp_kind;
+// Thresholds: non-critical at +/-5%, critical at +/-10%,
+// non-recoverable at 2.8V and 3.7V.
+typedef IPMI_SDR_Kind<mc_volt_linear, IPMI_SDR_UNIT_VOLTS,
+					  3700, 3630, 3465, 2800, 2970, 3135, 2, 2> mc_volt_kind;
+
+unsigned char IPMI_Device::sensor_state[IPMI_Device::ALL_SENSORS];
+
+#pragma PERSISTENT
+unsigned int IPMI_Device::sdr_reservation = 1;
+
+IPMI_Device::ipmi_sensor_reading_response_t IPMI_Device::sensor_frames[2][IPMI_Device::ALL_SENSORS];
+unsigned char IPMI_Device::sensor_frame = 0;
+bool IPMI_Device::encode_pending = false;
+
+unsigned int IPMI_Device::table_first = 0xFFFF;
+unsigned int IPMI_Device::table_next[IPMI_Device::TABLE_SENSORS];
+
+// Every slot starts out unused.
+#pragma PERSISTENT
+IPMI_Device::ipmi_sensor_table_entry_t IPMI_Device::sensor_table[IPMI_Device::TABLE_SENSORS] = { 0 };
+
+// The layout documented with ipmi_sensor_table_entry_t.
+IPMI_SDR_ASSERT(offsetof(IPMI_Device::ipmi_sensor_table_entry_t, sdr) == IPMI_Device::SENSOR_TABLE_SDR_OFFSET,
+				sensor_table_record_offset);
+IPMI_SDR_ASSERT(sizeof(IPMI_Device::ipmi_sensor_table_entry_t) == IPMI_Device::SENSOR_TABLE_SDR_OFFSET + sizeof(IPMI_Device::ipmi_sensor_record_t),
+				sensor_table_entry_padded);
+
+/*
+ *
+ * These are standard responses. Nothing here should have to be
+ * changed.
+ *
+ */
+
+//< \brief Get Device ID response image.
+IPMI::ipmi_response_t *IPMI_Device::device_id_response() {
+	return &device_id.rsp;
+}
+
+//< \brief Get SDR Info response image.
+IPMI::ipmi_response_t *IPMI_Device::sdr_info_response() {
+	return &sdr_info.rsp;
+}
+
+//< \brief Reserve Device SDR Repository response.
+//<
+//< Every reservation cancels the previous one.
+unsigned char *IPMI_Device::reserve_device_sdr_repository(unsigned char *target) {
+	cancel_sdr_reservation();
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = sdr_reservation & 0xFF;
+	*target++ = sdr_reservation >> 8;
+	return target;
+}
+
+//< \brief Cancel the current SDR reservation.
+//<
+//< Done for a new reservation, and whenever SDR content changes.
+//< The counter is persistent, so a BMC can't hold a reservation
+//< across a reset that changed the SDRs. 0 is never a valid ID.
+void IPMI_Device::cancel_sdr_reservation() {
+	if (++sdr_reservation == 0) sdr_reservation = 1;
+}
+
+//< \brief SDR content changed.
+//<
+//< Cancels the reservation and advances the change stamp returned by
+//< Get Device SDR Info (the 'sensor population change indicator'). A
+//< BMC that sees the same stamp as last time can skip re-reading the
+//< repository. The stamp lives in the (persistent) response image, so
+//< it survives a reset.
+void IPMI_Device::sdr_changed() {
+	cancel_sdr_reservation();
+	set_sdr_change_stamp(sdr_change_stamp() + 1);
+}
+
+//< \brief Current SDR change stamp.
+unsigned long IPMI_Device::sdr_change_stamp() {
+	return sdr_info.change[0] + ((unsigned int) sdr_info.change[1] << 8)
+			+ ((unsigned long) sdr_info.change[2] << 16) + ((unsigned long) sdr_info.change[3] << 24);
+}
+
+//< \brief Store the SDR change stamp in the Get Device SDR Info image.
+void IPMI_Device::set_sdr_change_stamp(unsigned long stamp) {
+	sdr_info.change[0] = stamp & 0xFF;
+	sdr_info.change[1] = (stamp >> 8) & 0xFF;
+	sdr_info.change[2] = (stamp >> 16) & 0xFF;
+	sdr_info.change[3] = (stamp >> 24) & 0xFF;
+	IPMI::compute_raw_check(&sdr_info.rsp);
+}
+
+//% \brief Device-specific background work.
+//%
+//% Called from the main loop. Finishes a put-off sensor reading encode.
+void IPMI_Device::process() {
+	if (encode_pending) encode_sensor_readings();
+}
+
+//< \brief Get FRU Inventory Area Info response.
+unsigned char *IPMI_Device::copy_fru_area_info(unsigned char fru_id, unsigned char *target) {
+	if (fru_id) {
+		*target++ = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+		return target;
+	}
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = sizeof(ipmi_fru_image_t) & 0xFF;
+	*target++ = sizeof(ipmi_fru_image_t) >> 8;
+	// Accessed by bytes.
+	*target++ = 0x00;
+	return target;
+}
+
+//< \brief Read FRU Data response.
+//<
+//< Fills in the completion code and count. The data goes out
+//< straight from the FRU image in FRAM: reads are trimmed to the
+//< end of the image and to what fits in one message.
+unsigned char *IPMI_Device::copy_fru_data(unsigned char fru_id,
+										  unsigned int offset,
+										  unsigned char count,
+										  unsigned char *target,
+										  const unsigned char **body,
+										  unsigned char *body_length) {
+	// We need 2 bytes for completion code + count.
+	const unsigned char copy_max = IPMI::tx_message_max() - IPMI::IPMI_MIN_MESSAGE_LENGTH - 2;
+
+	*body_length = 0;
+	if (fru_id) {
+		*target++ = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+		return target;
+	}
+	if (offset >= sizeof(ipmi_fru_image_t)) {
+		*target++ = IPMI::IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE;
+		return target;
+	}
+	if (count > sizeof(ipmi_fru_image_t) - offset) count = sizeof(ipmi_fru_image_t) - offset;
+	if (count > copy_max) count = copy_max;
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = count;
+	*body = ((const unsigned char *) &fru) + offset;
+	*body_length = count;
+	return target;
+}
+
+//< \brief Write FRU Data.
+//<
+//< Checksums are the writer's job, as usual. The board serial
+//< number is rewritten from Info at startup.
+unsigned char *IPMI_Device::write_fru_data(unsigned char fru_id,
+										   unsigned int offset,
+										   const unsigned char *data,
+										   unsigned char count,
+										   unsigned char *target) {
+	unsigned char *p;
+	unsigned char i;
+
+	if (fru_id) {
+		*target++ = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+		return target;
+	}
+	if (offset >= sizeof(ipmi_fru_image_t)) {
+		*target++ = IPMI::IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE;
+		return target;
+	}
+	if (count > sizeof(ipmi_fru_image_t) - offset) count = sizeof(ipmi_fru_image_t) - offset;
+	p = ((unsigned char *) &fru) + offset;
+	for (i=0;i<count;i++) p[i] = data[i];
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = count;
+	return target;
+}
+
+//< \brief Copy the serial number from Info into the FRU board area.
+void IPMI_Device::update_fru_serial() {
+	unsigned char *p;
+	unsigned char sum;
+	unsigned char i;
+
+	for (i=0;i<8;i++) fru.serial[1+i] = info.serial_number[i];
+	// Board area checksum covers everything in the area before it.
+	p = fru.board_header;
+	sum = 0;
+	while (p != &fru.board_checksum) sum += *p++;
+	fru.board_checksum = -sum;
+}
+
+//< \brief Get Device SDR response.
+//<
+//< Fills in the completion code and next record ID. The record
+//< data itself isn't copied: body/body_length point to it in FRAM.
+unsigned char *IPMI_Device::copy_sdr(unsigned int reservation,
+									 unsigned int sdr,
+									 unsigned char offset,
+									 unsigned char bytes,
+									 unsigned char *target,
+									 const unsigned char **body,
+									 unsigned char *body_length) {
+	ipmi_sdr_header_t *hdr;
+	const unsigned char *this_sdr;
+	unsigned int next;
+	unsigned char *p;
+
+	p = target + 1;
+	*target = IPMI::IPMI_COMPLETION_OK;
+	*body_length = 0;
+	// We need 3 bytes for next record ID + completion code
+	const unsigned char copy_max = IPMI::tx_message_max() - IPMI::IPMI_MIN_MESSAGE_LENGTH - 3;
+	// Does the SDR exist?
+	this_sdr = sdr_record(sdr);
+	if (!this_sdr) {
+		// No.
+		*target = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+		return p;
+	}
+	// Partial reads need a current reservation.
+	if (offset && reservation != sdr_reservation) {
+		*target = IPMI::IPMI_COMPLETION_RESERVATION_CANCELLED;
+		return p;
+	}
+	// Yes.
+	hdr = (ipmi_sdr_header_t *) this_sdr;
+
+	// Check if the offset goes too far. Record length is number
+	// of following bytes.
+	if (offset >= hdr->record_length + sizeof(ipmi_sdr_header_t)) {
+		*target = IPMI::IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE;
+		return p;
+	}
+	// It's a valid offset.
+	if (bytes == 0xFF) {
+		// Read Entire Record.
+		bytes = hdr->record_length + sizeof(ipmi_sdr_header_t) - offset;
+	} else {
+		if (offset + bytes > hdr->record_length + sizeof(ipmi_sdr_header_t)) {
+			*target = IPMI::IPMI_COMPLETION_REQUEST_DATA_TRUNCATED;
+			bytes = hdr->record_length + sizeof(ipmi_sdr_header_t) - offset;
+		}
+	}
+	if (bytes > copy_max) {
+		*target = IPMI::IPMI_COMPLETION_CANNOT_RETURN_NUMBER_OF_BYTES;
+		return p;
+	}
+	next = sdr_next_id(sdr);
+	*p++ = next & 0xFF;
+	*p++ = next >> 8;
+	*body = this_sdr + offset;
+	*body_length = bytes;
+	return p;
+}
+
+//% \brief SDR for a record ID, or 0 if not present.
+//%
+//% The built-in records come first, then the sensor table's slots.
+unsigned char *IPMI_Device::sdr_record(unsigned int sdr) {
+	if (sdr < NUM_SDRS) return sdrs[sdr];
+	if (sdr >= NUM_SDRS + TABLE_SENSORS) return 0;
+	if (!sensor_table_present(sdr - NUM_SDRS)) return 0;
+	return (unsigned char *) &sensor_table[sdr - NUM_SDRS].sdr;
+}
+
+//% \brief Record ID after a (present) record, or 0xFFFF for the last.
+unsigned int IPMI_Device::sdr_next_id(unsigned int sdr) {
+	if (sdr >= NUM_SDRS) return table_next[sdr - NUM_SDRS];
+	if (sdr + 1 < NUM_SDRS) return sdr + 1;
+	return table_first;
+}
+
+/*
+ *
+ * Sensor table.
+ *
+ */
+
+//% \brief Whether a sensor table slot holds a sensor.
+//%
+//% An entry that doesn't make sense (unknown source, an ADC channel we
+//% can't use, bad I2C address or width, shifts too large for the value)
+//% is treated as unused, so partly written entries can't do any harm.
+bool IPMI_Device::sensor_table_present(unsigned char slot) {
+	const ipmi_sensor_table_entry_t *entry;
+
+	if (slot >= TABLE_SENSORS) return false;
+	entry = &sensor_table[slot];
+	if (entry->raw_shift > 15 || entry->shift > 31) return false;
+	if (entry->source == source_ADC) return adc.channel_usable(entry->channel);
+	if (entry->source == source_I2C)
+		return (entry->channel < 0x80 && (entry->raw_bytes == 1 || entry->raw_bytes == 2));
+	return false;
+}
+
+//% \brief Fill in the fixed parts of the table's SDRs and chain their record IDs.
+//%
+//% Header, key and analog data format are ours to set: an entry
+//% only supplies the rest of its full sensor record.
+void IPMI_Device::index_sensor_table() {
+	ipmi_sensor_table_entry_t *entry;
+	unsigned int *next;
+	unsigned char count;
+	unsigned char i;
+
+	next = &table_first;
+	count = NUM_SDRS;
+	for (i=0;i<TABLE_SENSORS;i++) {
+		if (!sensor_table_present(i)) {
+			sensor_state[NUM_SENSORS+i] = 0;
+			continue;
+		}
+		entry = &sensor_table[i];
+		entry->sdr.hdr.record_id_lsb = (NUM_SDRS + i) & 0xFF;
+		entry->sdr.hdr.record_id_msb = (NUM_SDRS + i) >> 8;
+		entry->sdr.hdr.sdr_version = 0x51;
+		entry->sdr.hdr.record_type = 0x01;
+		entry->sdr.hdr.record_length = sizeof(ipmi_sensor_record_t) - sizeof(ipmi_sdr_header_t);
+		entry->sdr.key[0] = info.ipmi_address;
+		entry->sdr.key[1] = 0x00;
+		entry->sdr.key[2] = NUM_SENSORS + i;
+		// Readings are signed, like the built-in sensors.
+		entry->sdr.description.units[0] = (entry->sdr.description.units[0] & 0x3F) | IPMI_SDR_UNITS_2S_COMPLEMENT;
+		*next = NUM_SDRS + i;
+		next = &table_next[i];
+		count++;
+	}
+	*next = 0xFFFF;
+	sdr_info.count = count;
+}
+
+//% \brief The sensor table was written.
+//%
+//% Re-indexes it, and has Sensors pick up the new sources at the start
+//% of its next sample. 'sdrs' is whether the write changed the SDRs.
+void IPMI_Device::sensor_table_changed(bool sdrs) {
+	index_sensor_table();
+	if (sdrs) sdr_changed();
+	sensors.configure();
+	encode_sensor_readings();
+}
+
+//% \brief Get Sensor Table Entry (OEM) response.
+//%
+//% Same as Read FRU Data: completion code and count here, the
+//% entry's bytes straight from FRAM.
+unsigned char *IPMI_Device::copy_sensor_table_entry(unsigned char slot,
+													unsigned char offset,
+													unsigned char count,
+													unsigned char *target,
+													const unsigned char **body,
+													unsigned char *body_length) {
+	// We need 2 bytes for completion code + count.
+	const unsigned char copy_max = IPMI::tx_message_max() - IPMI::IPMI_MIN_MESSAGE_LENGTH - 2;
+
+	*body_length = 0;
+	if (slot >= TABLE_SENSORS || offset >= sizeof(ipmi_sensor_table_entry_t)) {
+		*target++ = IPMI::IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE;
+		return target;
+	}
+	if (count > sizeof(ipmi_sensor_table_entry_t) - offset) count = sizeof(ipmi_sensor_table_entry_t) - offset;
+	if (count > copy_max) count = copy_max;
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = count;
+	*body = ((const unsigned char *) &sensor_table[slot]) + offset;
+	*body_length = count;
+	return target;
+}
+
+//% \brief Set Sensor Table Entry (OEM).
+//%
+//% Writes bytes of an entry, like Write FRU Data. An entry takes more
+//% than one message, so clear its source first, write the rest, and
+//% set the source last. The SDRs only change (and the reservation is
+//% only cancelled) when that makes the entry appear or disappear, or
+//% when a present entry's record is written.
+unsigned char *IPMI_Device::write_sensor_table_entry(unsigned char slot,
+													 unsigned char offset,
+													 const unsigned char *data,
+													 unsigned char count,
+													 unsigned char *target) {
+	unsigned char *p;
+	unsigned char i;
+	bool present;
+
+	if (slot >= TABLE_SENSORS || offset >= sizeof(ipmi_sensor_table_entry_t)) {
+		*target++ = IPMI::IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE;
+		return target;
+	}
+	if (count > sizeof(ipmi_sensor_table_entry_t) - offset) count = sizeof(ipmi_sensor_table_entry_t) - offset;
+	present = sensor_table_present(slot);
+	p = ((unsigned char *) &sensor_table[slot]) + offset;
+	for (i=0;i<count;i++) p[i] = data[i];
+	// New sensor, or new thresholds: start from nothing asserted.
+	sensor_state[NUM_SENSORS+slot] = 0;
+	sensor_table_changed(present != sensor_table_present(slot) ||
+						 (present && offset + count > SENSOR_TABLE_SDR_OFFSET));
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = count;
+	return target;
+}
+
+/*
+ *
+ * Device-Specific data structures and functions.
+ *
+ */
+
+//% \brief Encode a sensor's current value as an 8-bit IPMI reading.
+signed char IPMI_Device::sensor_reading(unsigned char number) {
+	const ipmi_sensor_table_entry_t *entry;
+	long value;
+
+	if (number >= NUM_SENSORS) {
+		// Sensor table: ((raw - offset) * mul) >> shift, clamped.
+		entry = &sensor_table[number - NUM_SENSORS];
+		value = (long) sensors.table_values[number - NUM_SENSORS] - (int) (entry->offset_lsb | (entry->offset_msb << 8));
+		value *= (int) (entry->mul_lsb | (entry->mul_msb << 8));
+		value >>= entry->shift;
+		if (value < -128) return -128;
+		if (value > 127) return 127;
+		return value;
+	}
+	switch(__even_in_range(number<<1, (NUM_SENSORS-1)<<1)) {
+	case 0: return mc_temp_kind::conversion::encode(sensors.cal_values[0]);
+	case 2: return mc_volt_kind::conversion::encode(sensors.cal_values[1]);
+	default:
+		__never_executed();
+	}
+}
+
+//% \brief Get Sensor Reading response image for a sensor, or 0 if not present.
+IPMI::ipmi_response_t *IPMI_Device::sensor_reading_response(unsigned char number) {
+	if (!sensor_record(number)) return 0;
+	return &sensor_frames[sensor_frame][number].rsp;
+}
+
+//% \brief Encode every sensor's Get Sensor Reading response.
+//%
+//% Called once per sample (from evaluate_thresholds) and whenever
+//% the event receiver changes, so Get Sensor Reading just sends the
+//% image. The frames are double-buffered: we fill the idle set and
+//% then switch, so a response going out by DMA is never modified.
+//% A response can outlast a switch (retries and backoff), so if the
+//% idle set is still being sent, the encode waits for process().
+void IPMI_Device::encode_sensor_readings() {
+	ipmi_sensor_reading_response_t *frame;
+	unsigned char state;
+	unsigned char i;
+
+	encode_pending = sensor_frames_sending(sensor_frame ^ 1);
+	if (encode_pending) return;
+	// State: scanning enabled, plus event messages if we have a receiver.
+	if (IPMI::event_receiver != 0xFF) state = 0xC0;
+	else state = 0x40;
+	frame = sensor_frames[sensor_frame ^ 1];
+	for (i=0;i<ALL_SENSORS;i++,frame++) {
+		if (!sensor_record(i)) continue;
+		frame->reading = sensor_reading(i);
+		frame->state = state;
+		// Thresholds. Evaluated when the sensor was sampled.
+		frame->thresholds = sensor_state[i];
+		IPMI::compute_raw_check(&frame->rsp);
+	}
+	sensor_frame ^= 1;
+}
+
+//% \brief Whether a response from a set of sensor frames is being sent.
+bool IPMI_Device::sensor_frames_sending(unsigned char set) {
+	const unsigned char *p;
+
+	if (IPMI::ipmi_tx_state == IPMI::ipmi_TX_IDLE) return false;
+	p = IPMI::tx_address;
+	return (p >= (const unsigned char *) sensor_frames[set] &&
+			p < (const unsigned char *) sensor_frames[set + 1]);
+}
+
+//% \brief Reading, state and threshold bytes of Get Sensor Reading.
+unsigned char *IPMI_Device::copy_sensor_state(unsigned char number, unsigned char *target) {
+	ipmi_sensor_reading_response_t *frame;
+
+	frame = &sensor_frames[sensor_frame][number];
+	*target++ = frame->reading;
+	*target++ = frame->state;
+	*target++ = frame->thresholds;
+	return target;
+}
+
+//% \brief Get All Sensor Readings (OEM) response.
+//%
+//% Sensors from 'first' on, restricted to the bitmap if there is one
+//% (bit n of byte n/8 is sensor n: sensors past the end of the bitmap
+//% aren't selected). Each sensor is its number followed by the Get
+//% Sensor Reading bytes. If they don't all fit in 'space' bytes, the
+//% next-sensor byte says where to continue, otherwise it's 0xFF.
+unsigned char *IPMI_Device::copy_sensor_readings(unsigned char first,
+												 const unsigned char *bitmap,
+												 unsigned char bitmap_length,
+												 unsigned char *target,
+												 unsigned char space) {
+	unsigned char *next;
+	unsigned char n;
+
+	if (first >= ALL_SENSORS) {
+		*target++ = IPMI::IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE;
+		return target;
+	}
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	next = target++;
+	*next = 0xFF;
+	space -= 2;
+	for (n=first;n<ALL_SENSORS;n++) {
+		if (bitmap) {
+			if ((n >> 3) >= bitmap_length) break;
+			if (!(bitmap[n >> 3] & (1 << (n & 0x7)))) continue;
+		}
+		if (!sensor_record(n)) continue;
+		if (space < SENSOR_READINGS_ENTRY) {
+			*next = n;
+			break;
+		}
+		*target++ = n;
+		target = copy_sensor_state(n, target);
+		space -= SENSOR_READINGS_ENTRY;
+	}
+	return target;
+}
+
+//% \brief Sensor record for a sensor number, or 0 if not present.
+IPMI_Device::ipmi_sensor_record_t *IPMI_Device::sensor_record(unsigned char number) {
+	if (number < NUM_SENSORS) return sensor_records[number];
+	if (!sensor_table_present(number - NUM_SENSORS)) return 0;
+	return &sensor_table[number - NUM_SENSORS].sdr;
+}
+
+//% \brief A (present) sensor's thresholds: 6 bytes, SDR order.
+unsigned char *IPMI_Device::sensor_threshold_values(unsigned char number) {
+	return (unsigned char *) &sensor_record(number)->thresholds;
+}
+
+//% \brief A (present) sensor's hysteresis: positive, negative.
+unsigned char *IPMI_Device::sensor_hysteresis_values(unsigned char number) {
+	return &sensor_record(number)->thresholds.positive_hysteresis;
+}
+
+//% \brief Get Sensor Thresholds response.
+unsigned char *IPMI_Device::copy_sensor_thresholds(unsigned char number, unsigned char *target) {
+	ipmi_sensor_record_t *sensor;
+	const unsigned char *thresholds;
+	unsigned char i;
+
+	sensor = sensor_record(number);
+	if (!sensor) {
+		*target++ = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+		return target;
+	}
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = sensor->threshold_masks.settable_lsb & 0x3F;
+	// Response is ordered lower non-critical first, the SDR is the reverse.
+	thresholds = sensor_threshold_values(number);
+	for (i=0;i<6;i++) *target++ = thresholds[5-i];
+	return target;
+}
+
+//% \brief Set Sensor Thresholds.
+//%
+//% Values are in request order (lower non-critical first). Only
+//% thresholds in the mask are written, and the mask must be a subset
+//% of the SDR's settable mask: otherwise nothing is written.
+//% The sensor's record is updated in place in FRAM, so the change is
+//% persistent and is what Get Device SDR returns. Returns the
+//% completion code.
+unsigned char IPMI_Device::set_sensor_thresholds(unsigned char number,
+												 unsigned char mask,
+												 const unsigned char *values) {
+	ipmi_sensor_record_t *sensor;
+	unsigned char *thresholds;
+	unsigned char i;
+
+	sensor = sensor_record(number);
+	if (!sensor) return IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+	if (mask & ~(sensor->threshold_masks.settable_msb & 0x3F))
+		return IPMI::IPMI_COMPLETION_INVALID_DATA_FIELD;
+	thresholds = sensor_threshold_values(number);
+	for (i=0;i<6;i++) {
+		if (mask & (1<<i)) thresholds[5-i] = values[i];
+	}
+	sdr_changed();
+	// Pick up the new thresholds now rather than at the next sample.
+	evaluate_thresholds();
+	return IPMI::IPMI_COMPLETION_OK;
+}
+
+//% \brief Get Sensor Hysteresis response.
+unsigned char *IPMI_Device::copy_sensor_hysteresis(unsigned char number, unsigned char *target) {
+	const unsigned char *hysteresis;
+
+	if (!sensor_record(number)) {
+		*target++ = IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+		return target;
+	}
+	hysteresis = sensor_hysteresis_values(number);
+	*target++ = IPMI::IPMI_COMPLETION_OK;
+	*target++ = hysteresis[0];
+	*target++ = hysteresis[1];
+	return target;
+}
+
+//% \brief Set Sensor Hysteresis. Returns the completion code.
+unsigned char IPMI_Device::set_sensor_hysteresis(unsigned char number,
+												 unsigned char positive,
+												 unsigned char negative) {
+	unsigned char *hysteresis;
+
+	if (!sensor_record(number)) return IPMI::IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT;
+	hysteresis = sensor_hysteresis_values(number);
+	hysteresis[0] = positive;
+	hysteresis[1] = negative;
+	sdr_changed();
+	return IPMI::IPMI_COMPLETION_OK;
+}
+
+// Threshold state bits (as in Get Sensor Reading), in order. The
+// thresholds in the SDR are stored in the reverse order, so the
+// threshold for bit b is at index 5-b of ipmi_sensor_thresholds_t.
+// Each bit maps to a 'going low' (lower) or 'going high' (upper)
+// event offset.
+static const unsigned char threshold_event_offset[6] = { 0, 2, 4, 7, 9, 11 };
+
+//% \brief Evaluate sensor thresholds.
+//%
+//% Called by Sensors::process() once per new sample. Thresholds are
+//% evaluated with hysteresis: a lower threshold asserts at or below
+//% the threshold and deasserts above threshold + positive hysteresis,
+//% an upper threshold asserts at or above the threshold and deasserts
+//% below threshold - negative hysteresis. The result is cached for
+//% Get Sensor Reading, and changes generate Platform Events if the
+//% SDR's assertion/deassertion masks enable them.
+void IPMI_Device::evaluate_thresholds() {
+	ipmi_sensor_record_t *sensor;
+	const unsigned char *thresholds;
+	const unsigned char *hysteresis;
+	unsigned int assertions;
+	unsigned int deassertions;
+	unsigned char readable;
+	unsigned char state;
+	unsigned char mask;
+	unsigned char i, b;
+	signed char reading;
+	int threshold;
+	bool asserted;
+
+	for (i=0;i<ALL_SENSORS;i++) {
+		sensor = sensor_record(i);
+		if (!sensor) continue;
+		thresholds = sensor_threshold_values(i);
+		hysteresis = sensor_hysteresis_values(i);
+		readable = sensor->threshold_masks.settable_lsb & 0x3F;
+		assertions = sensor->threshold_masks.lower_lsb + (sensor->threshold_masks.lower_msb << 8);
+		deassertions = sensor->threshold_masks.upper_lsb + (sensor->threshold_masks.upper_msb << 8);
+		reading = sensor_reading(i);
+		state = sensor_state[i];
+		for (b=0,mask=1;b<6;b++,mask<<=1) {
+			if (!(readable & mask)) continue;
+			threshold = (signed char) thresholds[5-b];
+			if (b < 3) {
+				if (state & mask) asserted = (reading <= threshold + hysteresis[0]);
+				else asserted = (reading <= threshold);
+			} else {
+				if (state & mask) asserted = (reading >= threshold - hysteresis[1]);
+				else asserted = (reading >= threshold);
+			}
+			if (asserted == ((state & mask) != 0)) continue;
+			state ^= mask;
+			if (asserted) {
+				if (!(assertions & (1 << threshold_event_offset[b]))) continue;
+			} else {
+				if (!(deassertions & (1 << threshold_event_offset[b]))) continue;
+			}
+			// Event data 1: trigger reading in byte 2, trigger threshold in byte 3.
+			IPMI::send_platform_event(sensor->sensor_type,
+									  i,
+									  (asserted ? 0x00 : 0x80) | sensor->event_reading_type_code,
+									  0x50 | threshold_event_offset[b],
+									  reading,
+									  thresholds[5-b]);
+		}
+		sensor_state[i] = state;
+	}
+	encode_sensor_readings();
+}
+
+// Primary thing we need to do is make sure the SDRs have our IPMI address.
+void IPMI_Device::initialize() {
+	unsigned int i;
+	ipmi_sensor_reading_response_t *frame;
+	ipmi_mc_locator_record_t *mc;
+	const char *build;
+	unsigned long stamp;
+
+	// The stamp is reset (to 0) when new firmware is loaded, but the
+	// new SDRs may well differ from the old ones. So start it from
+	// a hash of the build time: a BMC won't have seen it before.
+	if (!sdr_change_stamp()) {
+		stamp = 0;
+		for (build = __DATE__ " " __TIME__;*build;build++) stamp = stamp*31 + *build;
+		set_sdr_change_stamp(stamp);
+	}
+	// Everything in the SDRs is fixed at compile time except our
+	// address. A new one changes the SDRs, which cancels the reservation.
+	mc = (ipmi_mc_locator_record_t *) sdrs[0];
+	if (mc->key[0] != info.ipmi_address) {
+		mc->key[0] = info.ipmi_address;
+		for (i=0;i<NUM_SENSORS;i++) sensor_records[i]->key[0] = info.ipmi_address;
+		sdr_changed();
+	}
+	// The sensor table's records (and the count) follow the built-in ones.
+	index_sensor_table();
+	update_fru_serial();
+	// Both sets of sensor reading frames.
+	frame = &sensor_frames[0][0];
+	for (i=0;i<2*ALL_SENSORS;i++,frame++) {
+		frame->rsp.data_length = 4;
+		frame->rsp.header.cmd = IPMI::IPMI_SENSOR_GET_SENSOR_READING;
+		frame->completion = IPMI::IPMI_COMPLETION_OK;
+	}
+	encode_sensor_readings();
+	// Fixed responses need their partial checks computed.
+	IPMI::compute_raw_check(&device_id.rsp);
+	IPMI::compute_raw_check(&sdr_info.rsp);
+}
+
+#pragma PERSISTENT
+IPMI_Device::ipmi_device_id_response_t IPMI_Device::device_id = {
+		.rsp = { .data_length = 1 + sizeof(IPMI_Device::ipmi_device_id_t), .header = { .cmd = IPMI::IPMI_APP_GET_DEVICE_ID } },
+		.completion = IPMI::IPMI_COMPLETION_OK,
+		.device_id = {
+				.id = 0x01,
+				.revision = (1<<7) | 0x00,
+				.ipmi = 0x51,
+				.capabilities = IPMI_SENSOR_DEVICE | IPMI_SEL_DEVICE | IPMI_FRU_INVENTORY_DEVICE | IPMI_IPMB_EVENT_GENERATOR,
+				.manufacturer = { (IANA_ENTERPRISE_ID_OHIO_STATE>> 0) & 0xFF,
+								  (IANA_ENTERPRISE_ID_OHIO_STATE>> 8) & 0xFF,
+								  (IANA_ENTERPRISE_ID_OHIO_STATE>>16) & 0xFF },
+				.product = { 0x00, 0x80 }
+		}
+};
+
+#pragma PERSISTENT
+IPMI_Device::ipmi_sdr_info_response_t IPMI_Device::sdr_info = {
+		.rsp = { .data_length = 7, .header = { .cmd = IPMI::IPMI_SENSOR_GET_DEVICE_SDR_INFO } },
+		.completion = IPMI::IPMI_COMPLETION_OK,
+		.count = IPMI_Device::NUM_SDRS,
+		.flags = IPMI_Device::SDR_FLAGS
+};
+
+// Board info area is 6 x 8 bytes, starting at 8. The serial
+// number is filled in (and the board checksum computed) at startup.
+#pragma PERSISTENT
+IPMI_Device::ipmi_fru_image_t IPMI_Device::fru = {
+		.common_header = { 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFE },
+		.board_header = { 0x01, 0x06, 0x00, 0x00, 0x00, 0x00 },
+		.manufacturer = { 0xCA, 'O','h','i','o',' ','S','t','a','t','e' },
+		.product = { 0xC7, 'T','I','S','C',' ','V','2' },
+		.serial = { 0xC8 },
+		.part = { 0xC4, 'T','I','S','C' },
+		.file_id = 0xC0,
+		.end = 0xC1,
+};
+
+/*
+ *
+ * SDR repository. The built-in sensors are listed in IPMI_DEVICE_SENSORS
+ * (in ipmi_device_specific.h), which assigns their sensor numbers and
+ * record IDs.
+ *
+ */
+
+// SDR header: record ID, type, length from the record.
+#define IPMI_SDR_HEADER( name , id , type )											\
+	{ (id) & 0xFF, (id) >> 8, 0x51, type, sizeof(name) - sizeof(IPMI_Device::ipmi_sdr_header_t) }
+// Full sensor record header: the record ID follows the sensor number.
+#define IPMI_SDR_SENSOR_HEADER( name )												\
+	IPMI_SDR_HEADER( name , IPMI_Device::sensor_##name + 1 , 0x01 )
+// Sensor record key: owner (our address, filled in at boot), LUN 0, sensor number.
+#define IPMI_SDR_SENSOR_KEY( name )													\
+	{ 0x00, 0x00, IPMI_Device::sensor_##name }
+
+#pragma PERSISTENT
+IPMI_Device::ipmi_mc_locator_record_t mc_locator_record = {
+		.hdr = IPMI_SDR_HEADER(mc_locator_record, 0, 0x12),
+		.capabilities = IPMI_SENSOR_DEVICE | IPMI_SEL_DEVICE | IPMI_FRU_INVENTORY_DEVICE | IPMI_IPMB_EVENT_GENERATOR,
+		.entity_id = 0x11,
+		.entity_instance = 0x00,
+		.id_type_length = 0xC8,
+		.id = { 'T','I','S','C',' ','V','2',' ' },
+};
+#pragma PERSISTENT
+IPMI_Device::ipmi_sensor_record_t mc_temp_sensor = {
+		.hdr = IPMI_SDR_SENSOR_HEADER(mc_temp_sensor),
+		.key = IPMI_SDR_SENSOR_KEY(mc_temp_sensor),
+		.entity_id = 0x11,
+		.entity_instance = 0x00,
+		.sensor_initialization = 0x3,
+		// auto re-arm, hysteresis settable, thresholds settable, global disable only
+		.sensor_capabilities = 0x6A,
+		.sensor_type = 0x01,
+		.event_reading_type_code = 0x01,
+		// Upper going-high assertions/deassertions, upper thresholds readable/settable.
+		.threshold_masks = { 0x80, 0x0A, 0x80, 0x0A, 0x38, 0x38 },
+		.description = IPMI_SDR_KIND_DESCRIPTION(mc_temp_kind),
+		.thresholds = IPMI_SDR_KIND_THRESHOLDS(mc_temp_kind),
+		.id_type_length = 0xC8,
+		.id = { 'M', 'S', 'P', '_', 'T', 'E', 'M', 'P' },
+};
+#pragma PERSISTENT
+IPMI_Device::ipmi_sensor_record_t mc_volt_sensor = {
+		.hdr = IPMI_SDR_SENSOR_HEADER(mc_volt_sensor),
+		.key = IPMI_SDR_SENSOR_KEY(mc_volt_sensor),
+		.entity_id = 0x11,
+		.entity_instance = 0x00,
+		.sensor_initialization = 0x3,
+		// auto re-arm, hysteresis settable, thresholds settable, global disable only
+		.sensor_capabilities = 0x6A,
+		.sensor_type = 0x02,
+		.event_reading_type_code = 0x01,
+		// All going-low lower and going-high upper assertions/deassertions, all thresholds readable/settable.
+		.threshold_masks = { 0x95, 0x0A, 0x95, 0x0A, 0x3F, 0x3F },
+		.description = IPMI_SDR_KIND_DESCRIPTION(mc_volt_kind),
+		.thresholds = IPMI_SDR_KIND_THRESHOLDS(mc_volt_kind),
+		.id_type_length = 0xC8,
+		.id = { 'M', 'S', 'P', '_', 'V', 'O', 'L', 'T' },
+};
+
+// No SDR is longer than a full sensor record with a 16 character ID.
+#define IPMI_SDR_CHECK( name , kind )												\
+	IPMI_SDR_ASSERT(sizeof(name) <= IPMI_SDR_MAX_LENGTH, name##_too_long);
+
+IPMI_SDR_CHECK(mc_locator_record, 0)
+IPMI_DEVICE_SENSORS(IPMI_SDR_CHECK)
+
+// At the longest message setting a whole full record is one Get Device
+// SDR response: completion code, next record ID, then the record.
+IPMI_SDR_ASSERT(IPMI::IPMI_MIN_MESSAGE_LENGTH + 3 + sizeof(IPMI_Device::ipmi_sensor_record_t) <= IPMI::TX_MESSAGE_LIMIT,
+				full_record_needs_more_than_one_message);
+
+#define IPMI_SDR_POINTER( name , kind ) (unsigned char *) &name,
+#define IPMI_SENSOR_RECORD( name , kind ) &name,
+
+unsigned char * const IPMI_Device::sdrs[IPMI_Device::NUM_SDRS] = {
+		(unsigned char *) &mc_locator_record,
+		IPMI_DEVICE_SENSORS(IPMI_SDR_POINTER)
+};
+
+IPMI_Device::ipmi_sensor_record_t * const IPMI_Device::sensor_records[IPMI_Device::NUM_SENSORS] = {
+		IPMI_DEVICE_SENSORS(IPMI_SENSOR_RECORD)
+};
@@ -1,143 +1,321 @@
-/*
- * ipmi_device_specific.h
- *
- *  Created on: Feb 18, 2016
- *      Author: barawn
- */
-
-#ifndef IPMI_DEVICE_SPECIFIC_H_
-#define IPMI_DEVICE_SPECIFIC_H_
-
-#include "ipmiv2.h"
-
-#define IANA_ENTERPRISE_ID_OHIO_STATE (100)
-#define IANA_ENTERPRISE_ID_UNIVERSITY_OF_HAWAII (2160)
-
-#define IPMI_SENSOR_DEVICE 			0x01
-#define IPMI_SDR_REPOSITORY_DEVICE 	0x02
-#define IPMI_SEL_DEVICE				0x04
-#define IPMI_FRU_INVENTORY_DEVICE	0x08
-#define IPMI_IPMB_EVENT_RECEIVER	0x10
-#define IPMI_IPMB_EVENT_GENERATOR	0x20
-#define IPMI_BRIDGE					0x40
-#define IPMI_CHASSIS_DEVICE			0x80
-
-// Encode 4 ASCII chars in 3 bytes.
-#define IPMI_6BIT_ASCII_QUAD( a , b , c, d ) \
-	 ( ( ((b-0x20) & 0x3 )<<6 )|(   (a-0x20) & 0x3F)     )		\
-	,( ( ((c-0x20) & 0xF )<<4 )|(  ((b-0x20) & 0x3C)>>2) )		\
-	,( ( ((d-0x20) & 0x3F)<<2 )|(  ((c-0x20) & 0x30)>>4) )
-
-class IPMI_Device {
-public:
-	IPMI_Device() {}
-
-	static void initialize();
-
-	typedef struct ipmi_device_id {
-		unsigned char id;
-		unsigned char revision;
-		unsigned char fw_major;
-		unsigned char fw_minor;
-		unsigned char ipmi;
-		unsigned char capabilities;
-		unsigned char manufacturer[3];
-		unsigned char product[2];
-	} ipmi_device_id_t;
-
-	typedef struct ipmi_sdr_header {
-		unsigned char record_id_lsb;
-		unsigned char record_id_msb;
-		unsigned char sdr_version;
-		unsigned char record_type;
-		unsigned char record_length;
-	} ipmi_sdr_header_t;
-
-	typedef struct ipmi_sensor_threshold_masks {
-		unsigned char lower_lsb;
-		unsigned char lower_msb;
-		unsigned char upper_lsb;
-		unsigned char upper_msb;
-		unsigned char settable_lsb;
-		unsigned char settable_msb;
-	} ipmi_sensor_threshold_masks_t;
-
-	typedef struct ipmi_sensor_thresholds {
-		unsigned char upper_nonrecoverable;
-		unsigned char upper_critical;
-		unsigned char upper_noncritical;
-		unsigned char lower_nonrecoverable;
-		unsigned char lower_critical;
-		unsigned char lower_noncritical;
-		unsigned char positive_hysteresis;
-		unsigned char negative_hysteresis;
-	} ipmi_sensor_thresholds_t;
-
-	typedef struct ipmi_sensor_description {
-		unsigned char units[3];
-		unsigned char linearization;
-		unsigned char m;
-		unsigned char tolerance;
-		unsigned char b;
-		unsigned char accuracy;
-		unsigned char accuracy_exp;
-		unsigned char rexp_bexp;
-	} ipmi_sensor_description_t;
-
-	typedef struct ipmi_mc_locator_record {
-		IPMI_Device::ipmi_sdr_header_t hdr;
-		unsigned char key[2];
-		unsigned char power_state;
-		unsigned char capabilities;
-		unsigned char reserved[3];
-		unsigned char entity_id;
-		unsigned char entity_instance;
-		unsigned char oem;
-		unsigned char id_type_length;
-		unsigned char id[8];
-	} ipmi_mc_locator_record_t;
-
-	typedef struct ipmi_sensor_record {
-		IPMI_Device::ipmi_sdr_header_t hdr;
-		unsigned char key[3];
-		unsigned char entity_id;
-		unsigned char entity_instance;
-		unsigned char sensor_initialization;
-		unsigned char sensor_capabilities;
-		unsigned char sensor_type;
-		unsigned char event_reading_type_code;
-		ipmi_sensor_threshold_masks_t threshold_masks;
-		ipmi_sensor_description_t description;
-		unsigned char analog_flags;
-		unsigned char nominal;
-		unsigned char nominal_max;
-		unsigned char nominal_min;
-		unsigned char sensor_max;
-		unsigned char sensor_min;
-		ipmi_sensor_thresholds_t thresholds;
-		unsigned char reserved[2];
-		unsigned char oem;
-		unsigned char id_type_length;
-		unsigned char id[8];
-	} ipmi_sensor_record_t;
-
-	static unsigned char *copy_device_id(unsigned char *target);
-	static unsigned char *copy_sdr(unsigned int sdr,
-							unsigned char offset,
-							unsigned char bytes,
-							unsigned char *target);
-	static unsigned char *copy_sdr_info(unsigned char operation,
-										unsigned char *target);
-	static unsigned char *reserve_device_sdr_repository(unsigned char *target);
-	static unsigned char *copy_sensor_reading(unsigned char number, unsigned char *target);
-private:
-	const unsigned char DEVICE_ID_LENGTH = 18;
-	const unsigned char NUM_SDRS = 3;
-	const unsigned char SDR_FLAGS = 1;
-	static ipmi_device_id_t device_id;
-	static unsigned char *sdrs[NUM_SDRS];
-};
-
-extern IPMI_Device thisDevice;
-
-#endif /* IPMI_DEVICE_SPECIFIC_H_ */
+/*
+ * ipmi_device_specific.h
+ *
+ *  Created on: Feb 18, 2016
+ *      Author: barawn
+ */
+
+#ifndef IPMI_DEVICE_SPECIFIC_H_
+#define IPMI_DEVICE_SPECIFIC_H_
+
+#include "ipmiv2.h"
+
+#define IANA_ENTERPRISE_ID_OHIO_STATE (100)
+#define IANA_ENTERPRISE_ID_UNIVERSITY_OF_HAWAII (2160)
+
+#define IPMI_SENSOR_DEVICE 			0x01
+#define IPMI_SDR_REPOSITORY_DEVICE 	0x02
+#define IPMI_SEL_DEVICE				0x04
+#define IPMI_FRU_INVENTORY_DEVICE	0x08
+#define IPMI_IPMB_EVENT_RECEIVER	0x10
+#define IPMI_IPMB_EVENT_GENERATOR	0x20
+#define IPMI_BRIDGE					0x40
+#define IPMI_CHASSIS_DEVICE			0x80
+
+// The built-in sensors, in sensor number order: the name of each
+// one's full sensor record, defined in ipmi_device_specific.cpp, and
+// its kind (an IPMI_SDR_Kind typedef, also there). Sensor numbers come
+// from this list, and so do record IDs: the MC locator is record 0,
+// then each sensor's record, in sensor number order.
+#define IPMI_DEVICE_SENSORS( SENSOR )			\
+	SENSOR( mc_temp_sensor , mc_temp_kind )	\
+	SENSOR( mc_volt_sensor , mc_volt_kind )
+
+#define IPMI_SENSOR_NUMBER( name , kind ) sensor_##name,
+
+// Encode 4 ASCII chars in 3 bytes.
+#define IPMI_6BIT_ASCII_QUAD( a , b , c, d ) \
+	 ( ( ((b-0x20) & 0x3 )<<6 )|(   (a-0x20) & 0x3F)     )		\
+	,( ( ((c-0x20) & 0xF )<<4 )|(  ((b-0x20) & 0x3C)>>2) )		\
+	,( ( ((d-0x20) & 0x3F)<<2 )|(  ((c-0x20) & 0x30)>>4) )
+
+class IPMI_Device {
+public:
+	IPMI_Device() {}
+
+	static void initialize();
+	static void process();
+
+	// Sensor numbers.
+	typedef enum sensor_number {
+		IPMI_DEVICE_SENSORS(IPMI_SENSOR_NUMBER)
+		sensor_MAX
+	} sensor_number_t;
+
+	typedef struct ipmi_device_id {
+		unsigned char id;
+		unsigned char revision;
+		unsigned char fw_major;
+		unsigned char fw_minor;
+		unsigned char ipmi;
+		unsigned char capabilities;
+		unsigned char manufacturer[3];
+		unsigned char product[2];
+	} ipmi_device_id_t;
+
+	typedef struct ipmi_device_id_response {
+		IPMI::ipmi_response_t rsp;
+		unsigned char completion;
+		ipmi_device_id_t device_id;
+		unsigned char check2;
+	} ipmi_device_id_response_t;
+
+	typedef struct ipmi_sdr_info_response {
+		IPMI::ipmi_response_t rsp;
+		unsigned char completion;
+		unsigned char count;
+		unsigned char flags;
+		unsigned char change[4];
+		unsigned char check2;
+	} ipmi_sdr_info_response_t;
+
+	typedef struct ipmi_sensor_reading_response {
+		IPMI::ipmi_response_t rsp;
+		unsigned char completion;
+		unsigned char reading;
+		unsigned char state;
+		unsigned char thresholds;
+		unsigned char check2;
+	} ipmi_sensor_reading_response_t;
+
+	typedef struct ipmi_sdr_header {
+		unsigned char record_id_lsb;
+		unsigned char record_id_msb;
+		unsigned char sdr_version;
+		unsigned char record_type;
+		unsigned char record_length;
+	} ipmi_sdr_header_t;
+
+	typedef struct ipmi_sensor_threshold_masks {
+		unsigned char lower_lsb;
+		unsigned char lower_msb;
+		unsigned char upper_lsb;
+		unsigned char upper_msb;
+		unsigned char settable_lsb;
+		unsigned char settable_msb;
+	} ipmi_sensor_threshold_masks_t;
+
+	typedef struct ipmi_sensor_thresholds {
+		unsigned char upper_nonrecoverable;
+		unsigned char upper_critical;
+		unsigned char upper_noncritical;
+		unsigned char lower_nonrecoverable;
+		unsigned char lower_critical;
+		unsigned char lower_noncritical;
+		unsigned char positive_hysteresis;
+		unsigned char negative_hysteresis;
+	} ipmi_sensor_thresholds_t;
+
+	typedef struct ipmi_sensor_description {
+		unsigned char units[3];
+		unsigned char linearization;
+		unsigned char m;
+		unsigned char tolerance;
+		unsigned char b;
+		unsigned char accuracy;
+		unsigned char accuracy_exp;
+		unsigned char rexp_bexp;
+	} ipmi_sensor_description_t;
+
+	typedef struct ipmi_mc_locator_record {
+		IPMI_Device::ipmi_sdr_header_t hdr;
+		unsigned char key[2];
+		unsigned char power_state;
+		unsigned char capabilities;
+		unsigned char reserved[3];
+		unsigned char entity_id;
+		unsigned char entity_instance;
+		unsigned char oem;
+		unsigned char id_type_length;
+		unsigned char id[8];
+	} ipmi_mc_locator_record_t;
+
+	typedef struct ipmi_sensor_record {
+		IPMI_Device::ipmi_sdr_header_t hdr;
+		unsigned char key[3];
+		unsigned char entity_id;
+		unsigned char entity_instance;
+		unsigned char sensor_initialization;
+		unsigned char sensor_capabilities;
+		unsigned char sensor_type;
+		unsigned char event_reading_type_code;
+		ipmi_sensor_threshold_masks_t threshold_masks;
+		ipmi_sensor_description_t description;
+		unsigned char analog_flags;
+		unsigned char nominal;
+		unsigned char nominal_max;
+		unsigned char nominal_min;
+		unsigned char sensor_max;
+		unsigned char sensor_min;
+		ipmi_sensor_thresholds_t thresholds;
+		unsigned char reserved[2];
+		unsigned char oem;
+		unsigned char id_type_length;
+		unsigned char id[8];
+	} ipmi_sensor_record_t;
+
+	// Sensor table: sensors defined at runtime (OEM commands or the
+	// CLI), kept in FRAM, so one image serves every board variant.
+	// Slot i is sensor number sensor_MAX+i and record ID NUM_SDRS+i,
+	// after the built-in ones. Unused slots are just absent.
+	const unsigned char TABLE_SENSORS = 8;
+	typedef enum sensor_source {
+		source_NONE = 0,				//< Unused slot.
+		source_ADC = 1,					//< ADC12 channel, AVCC reference.
+		source_I2C = 2,					//< Register on the Twi bus.
+		source_MAX = source_I2C
+	} sensor_source_t;
+
+	// The raw value is the ADC count, or raw_bytes (1 or 2, MSB first)
+	// read from the I2C register, shifted right by raw_shift. The reading
+	// is ((raw - offset) * mul) >> shift, clamped: the same multiply-shift
+	// IPMI_SDR_Linear generates for the built-in sensors, so work out mul
+	// and shift to match the SDR's M and B. The SDR's header and key are
+	// filled in when the entry is written.
+	//
+	// An entry is all bytes, so there's no padding and it's the same in
+	// FRAM as over IPMI (Get/Set Sensor Table Entry offsets):
+	//   0 source, 1 channel, 2 reg, 3 raw_bytes, 4 raw_shift, 5 shift,
+	//   6-7 offset, 8-9 mul (both signed 16-bit, LSB first),
+	//   10-65 the full sensor record.
+	typedef struct ipmi_sensor_table_entry {
+		unsigned char source;			//< sensor_source_t
+		unsigned char channel;			//< ADC channel (see ADC::channel_usable()), or I2C (7-bit) address.
+		unsigned char reg;				//< I2C register.
+		unsigned char raw_bytes;
+		unsigned char raw_shift;
+		unsigned char shift;
+		unsigned char offset_lsb;
+		unsigned char offset_msb;
+		unsigned char mul_lsb;
+		unsigned char mul_msb;
+		ipmi_sensor_record_t sdr;
+	} ipmi_sensor_table_entry_t;
+	const unsigned char SENSOR_TABLE_SDR_OFFSET = 10;
+
+	static ipmi_sensor_table_entry_t sensor_table[TABLE_SENSORS];
+
+	// FRU image: common header plus a board info area.
+	typedef struct ipmi_fru_image {
+		unsigned char common_header[8];
+		unsigned char board_header[6];
+		unsigned char manufacturer[11];
+		unsigned char product[8];
+		unsigned char serial[9];
+		unsigned char part[5];
+		unsigned char file_id;
+		unsigned char end;
+		unsigned char pad[6];
+		unsigned char board_checksum;
+	} ipmi_fru_image_t;
+
+	static IPMI::ipmi_response_t *device_id_response();
+	static IPMI::ipmi_response_t *sdr_info_response();
+	static unsigned char *copy_sdr(unsigned int reservation,
+							unsigned int sdr,
+							unsigned char offset,
+							unsigned char bytes,
+							unsigned char *target,
+							const unsigned char **body,
+							unsigned char *body_length);
+	static unsigned char *reserve_device_sdr_repository(unsigned char *target);
+	static void sdr_changed();
+	static unsigned long sdr_change_stamp();
+	static IPMI::ipmi_response_t *sensor_reading_response(unsigned char number);
+	static void encode_sensor_readings();
+	static unsigned char *copy_sensor_readings(unsigned char first,
+											   const unsigned char *bitmap,
+											   unsigned char bitmap_length,
+											   unsigned char *target,
+											   unsigned char space);
+	static unsigned char *copy_sensor_thresholds(unsigned char number, unsigned char *target);
+	static unsigned char set_sensor_thresholds(unsigned char number,
+											   unsigned char mask,
+											   const unsigned char *values);
+	static unsigned char *copy_sensor_hysteresis(unsigned char number, unsigned char *target);
+	static unsigned char set_sensor_hysteresis(unsigned char number,
+											   unsigned char positive,
+											   unsigned char negative);
+	static void evaluate_thresholds();
+	static unsigned char *copy_fru_area_info(unsigned char fru_id, unsigned char *target);
+	static unsigned char *copy_fru_data(unsigned char fru_id,
+										unsigned int offset,
+										unsigned char count,
+										unsigned char *target,
+										const unsigned char **body,
+										unsigned char *body_length);
+	static unsigned char *write_fru_data(unsigned char fru_id,
+										 unsigned int offset,
+										 const unsigned char *data,
+										 unsigned char count,
+										 unsigned char *target);
+	static void update_fru_serial();
+	static unsigned char *copy_sensor_table_entry(unsigned char slot,
+												  unsigned char offset,
+												  unsigned char count,
+												  unsigned char *target,
+												  const unsigned char **body,
+												  unsigned char *body_length);
+	static unsigned char *write_sensor_table_entry(unsigned char slot,
+												   unsigned char offset,
+												   const unsigned char *data,
+												   unsigned char count,
+												   unsigned char *target);
+	static bool sensor_table_present(unsigned char slot);
+private:
+	static void cancel_sdr_reservation();
+	static void set_sdr_change_stamp(unsigned long stamp);
+	static signed char sensor_reading(unsigned char number);
+	static unsigned char *copy_sensor_state(unsigned char number, unsigned char *target);
+	// Sensor number + reading, state, thresholds.
+	const unsigned char SENSOR_READINGS_ENTRY = 4;
+	static ipmi_sensor_record_t *sensor_record(unsigned char number);
+	static unsigned char *sensor_threshold_values(unsigned char number);
+	static unsigned char *sensor_hysteresis_values(unsigned char number);
+	static unsigned char *sdr_record(unsigned int sdr);
+	static unsigned int sdr_next_id(unsigned int sdr);
+	static void index_sensor_table();
+	static void sensor_table_changed(bool sdrs);
+	const unsigned char DEVICE_ID_LENGTH = 18;
+	const unsigned char NUM_SENSORS = sensor_MAX;
+	// The MC locator, then a full record per sensor.
+	const unsigned char NUM_SDRS = 1 + NUM_SENSORS;
+	// Built-in sensors, then the sensor table.
+	const unsigned char ALL_SENSORS = NUM_SENSORS + TABLE_SENSORS;
+	// Dynamic population (so the change indicator is present), LUN 0 has sensors.
+	const unsigned char SDR_FLAGS = 0x81;
+	static ipmi_device_id_response_t device_id;
+	static ipmi_sdr_info_response_t sdr_info;
+	// Built-in records, by record ID, and each built-in sensor's record.
+	static unsigned char * const sdrs[NUM_SDRS];
+	static ipmi_sensor_record_t * const sensor_records[NUM_SENSORS];
+	// Record ID chain through the present table slots (0xFFFF at the end).
+	static unsigned int table_first;
+	static unsigned int table_next[TABLE_SENSORS];
+	static ipmi_fru_image_t fru;
+	// Current SDR reservation ID.
+	static unsigned int sdr_reservation;
+	// Threshold comparison state, as returned by Get Sensor Reading.
+	static unsigned char sensor_state[ALL_SENSORS];
+	// Get Sensor Reading responses, double-buffered. sensor_frame is the current set.
+	// encode_pending is an encode put off because the idle set was
+	// still being sent.
+	static ipmi_sensor_reading_response_t sensor_frames[2][ALL_SENSORS];
+	static unsigned char sensor_frame;
+	static bool encode_pending;
+	static bool sensor_frames_sending(unsigned char set);
+};
+
+extern IPMI_Device thisDevice;
+
+#endif /* IPMI_DEVICE_SPECIFIC_H_ */
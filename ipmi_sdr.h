@@ -0,0 +1,171 @@
+/*
+ * ipmi_sdr.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef IPMI_SDR_H_
+#define IPMI_SDR_H_
+
+// Compile-time assertion (negative array size if it fails).
+#define IPMI_SDR_ASSERT( cond , name ) typedef char name[(cond) ? 1 : -1]
+
+// Longest SDR: a full sensor record with a 16 character ID string.
+#define IPMI_SDR_MAX_LENGTH 64
+
+// Analog data format (units byte 1): readings are 2's complement.
+#define IPMI_SDR_UNITS_2S_COMPLEMENT 0x80
+
+#define IPMI_SDR_UNITS( unit ) { IPMI_SDR_UNITS_2S_COMPLEMENT, unit, 0x00 }
+
+#define IPMI_SDR_UNIT_DEGREES_C		0x01
+#define IPMI_SDR_UNIT_VOLTS			0x04
+#define IPMI_SDR_UNIT_AMPS			0x05
+#define IPMI_SDR_UNIT_WATTS			0x06
+
+//% \brief Decimal (10-bit significand, exponent) form of V * 10^E.
+//%
+//% Trailing zeros go into the exponent, and anything too big for the
+//% 10-bit 2's complement significand is rounded to fit.
+template <long V, int E, bool REDUCE = ((V != 0 && (V % 10) == 0) || V > 511 || V < -512)>
+struct IPMI_SDR_Decimal {
+	static const long SIGNIFICAND = V;
+	static const int EXPONENT = E;
+};
+
+template <long V, int E>
+struct IPMI_SDR_Decimal<V, E, true> {
+	typedef IPMI_SDR_Decimal<((V % 10) == 0) ? V/10 : (V + (V < 0 ? -5 : 5))/10, E+1> reduced;
+	static const long SIGNIFICAND = reduced::SIGNIFICAND;
+	static const int EXPONENT = reduced::EXPONENT;
+};
+
+//% \brief log2 of N, or -1 if N isn't a power of 2.
+template <long N>
+struct IPMI_SDR_Log2 {
+	static const int VALUE = ((N & 1) || N < 2) ? -1 : (IPMI_SDR_Log2<N/2>::VALUE < 0 ? -1 : IPMI_SDR_Log2<N/2>::VALUE + 1);
+};
+
+template <>
+struct IPMI_SDR_Log2<1> {
+	static const int VALUE = 0;
+};
+
+template <>
+struct IPMI_SDR_Log2<0> {
+	static const int VALUE = -1;
+};
+
+//% \brief Linear sensor conversion, derived at compile time.
+//%
+//% MIN and MAX are the physical range the sensor has to cover, in the
+//% units the sensor value is kept in: 10^UNIT_EXP of the SDR unit
+//% (so millivolts are UNIT_EXP = -3 for volts). From that we get the
+//% SDR linear conversion, y = (M*x + B*10^Bexp) * 10^Rexp, with x the
+//% signed 8-bit reading:
+//%
+//%   M is the smallest step that covers MIN..MAX in 254 readings
+//%   (one less than we have, so the range can sit around the centre).
+//%   B*10^Bexp is the centre of the range (reading 0), rounded to fit B.
+//%   Rexp is UNIT_EXP.
+//%
+//% encode() is the matching conversion from a sensor value to a reading.
+//% It's a multiply by a precomputed reciprocal of M and a shift, so
+//% there's no runtime division: when M is a power of 2 it's just the
+//% shift. Otherwise it multiplies by 2^20/M, rounded up, which makes
+//% encode() floor((value - OFFSET)/M), clamped, for M up to 64. Past
+//% that a value just under a step can encode one count high.
+//%
+//% Reading<V>::VALUE is encode(V) as a constant, for thresholds: they
+//% then match what encode() produces by construction.
+//%
+//% IPMI_SDR_LINEAR_DESCRIPTION(type, unit) is an initializer for the
+//% SDR's ipmi_sensor_description_t.
+template <long MIN, long MAX, int UNIT_EXP>
+class IPMI_SDR_Linear {
+public:
+	static const long SPAN = MAX - MIN;
+	static const long M = (SPAN + 253)/254;
+	typedef IPMI_SDR_Decimal<(MIN + MAX)/2, 0> offset;
+	static const long B = offset::SIGNIFICAND;
+	static const int BEXP = offset::EXPONENT;
+	static const int REXP = UNIT_EXP;
+	// Sensor value that encodes as reading 0.
+	static const long OFFSET = B * (BEXP > 0 ? 10L : 1L) * (BEXP > 1 ? 10L : 1L) * (BEXP > 2 ? 10L : 1L)
+									* (BEXP > 3 ? 10L : 1L) * (BEXP > 4 ? 10L : 1L) * (BEXP > 5 ? 10L : 1L)
+									* (BEXP > 6 ? 10L : 1L);
+	// Sensor value that encodes as reading -128. Encoding works from
+	// here so the multiply only ever sees positive numbers.
+	static const long LOW = OFFSET - 128*M;
+	// 256 steps of M times the reciprocal stays well inside 32 bits.
+	static const int SHIFT = (IPMI_SDR_Log2<M>::VALUE >= 0) ? IPMI_SDR_Log2<M>::VALUE : 20;
+	static const long MUL = (IPMI_SDR_Log2<M>::VALUE >= 0) ? 1 : ((1L << 20) + M - 1)/M;
+
+	template <long V>
+	struct Reading {
+		static const long STEPS = (V < LOW) ? 0 : ((V - LOW >= 256*M) ? 255 : (((V - LOW) * MUL) >> SHIFT));
+		static const signed char VALUE = STEPS - 128;
+	};
+
+	static signed char encode(long value) {
+		value -= LOW;
+		if (value < 0) return -128;
+		if (value >= 256*M) return 127;
+		return ((value * MUL) >> SHIFT) - 128;
+	}
+
+private:
+	// M and B are 10-bit 2's complement, the exponents 4-bit.
+	IPMI_SDR_ASSERT(MAX > MIN, range_is_empty);
+	IPMI_SDR_ASSERT(M <= 511, range_too_wide_for_m);
+	IPMI_SDR_ASSERT(BEXP <= 7, offset_exponent_too_large);
+	IPMI_SDR_ASSERT(REXP >= -8 && REXP <= 7, result_exponent_out_of_range);
+	// Rounding B can't move the range out from under the readings.
+	IPMI_SDR_ASSERT(MIN - OFFSET >= -128*M && MAX - OFFSET <= 127*M, offset_does_not_cover_range);
+};
+
+#define IPMI_SDR_LINEAR_DESCRIPTION( type , unit )									\
+	{ .units = IPMI_SDR_UNITS(unit),												\
+	  .linearization = 0x00,														\
+	  .m = type::M & 0xFF,															\
+	  .tolerance = (type::M >> 2) & 0xC0,											\
+	  .b = type::B & 0xFF,															\
+	  .accuracy = (type::B >> 2) & 0xC0,											\
+	  .accuracy_exp = 0x00,															\
+	  .rexp_bexp = ((type::REXP & 0xF) << 4) | (type::BEXP & 0xF) }
+
+//% \brief A kind of built-in sensor: conversion, unit, thresholds and hysteresis.
+//%
+//% Thresholds are sensor values, like the conversion's MIN and MAX, in
+//% SDR order (upper non-recoverable first): unreadable ones are don't
+//% cares. The record is initialized from the kind with
+//% IPMI_SDR_KIND_DESCRIPTION and IPMI_SDR_KIND_THRESHOLDS.
+template <class CONVERSION, unsigned char UNIT,
+		  long UNR, long UC, long UNC, long LNR, long LC, long LNC,
+		  unsigned char POSITIVE, unsigned char NEGATIVE>
+struct IPMI_SDR_Kind {
+	typedef CONVERSION conversion;
+	static const unsigned char UNITS = UNIT;
+	static const unsigned char UPPER_NONRECOVERABLE = (unsigned char) CONVERSION::template Reading<UNR>::VALUE;
+	static const unsigned char UPPER_CRITICAL = (unsigned char) CONVERSION::template Reading<UC>::VALUE;
+	static const unsigned char UPPER_NONCRITICAL = (unsigned char) CONVERSION::template Reading<UNC>::VALUE;
+	static const unsigned char LOWER_NONRECOVERABLE = (unsigned char) CONVERSION::template Reading<LNR>::VALUE;
+	static const unsigned char LOWER_CRITICAL = (unsigned char) CONVERSION::template Reading<LC>::VALUE;
+	static const unsigned char LOWER_NONCRITICAL = (unsigned char) CONVERSION::template Reading<LNC>::VALUE;
+	static const unsigned char POSITIVE_HYSTERESIS = POSITIVE;
+	static const unsigned char NEGATIVE_HYSTERESIS = NEGATIVE;
+};
+
+#define IPMI_SDR_KIND_DESCRIPTION( kind ) IPMI_SDR_LINEAR_DESCRIPTION(kind::conversion, kind::UNITS)
+
+#define IPMI_SDR_KIND_THRESHOLDS( kind )										\
+	{ .upper_nonrecoverable = kind::UPPER_NONRECOVERABLE,						\
+	  .upper_critical = kind::UPPER_CRITICAL,									\
+	  .upper_noncritical = kind::UPPER_NONCRITICAL,								\
+	  .lower_nonrecoverable = kind::LOWER_NONRECOVERABLE,						\
+	  .lower_critical = kind::LOWER_CRITICAL,									\
+	  .lower_noncritical = kind::LOWER_NONCRITICAL,								\
+	  .positive_hysteresis = kind::POSITIVE_HYSTERESIS,							\
+	  .negative_hysteresis = kind::NEGATIVE_HYSTERESIS }
+
+#endif /* IPMI_SDR_H_ */
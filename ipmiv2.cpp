@@ -1,526 +1,1718 @@
-#include <msp430.h>
-#include "ipmiv2.h"
-#include "ui.h"
-#include "clock.h"
-#include "info.h"
-#include "ipmi_device_specific.h"
-
-IPMI ipmi;
-
-IPMI::ipmi_rx_state_t IPMI::ipmi_rx_state = ipmi_RX_IDLE;
-unsigned char IPMI::rx_buffer[IPMI::RX_BUFFER_SIZE];
-unsigned int IPMI::rx_buffer_remaining = 0;
-
-IPMI::ipmi_tx_state_t IPMI::ipmi_tx_state = ipmi_TX_IDLE;
-unsigned char IPMI::tx_retry_count = 0;
-unsigned int IPMI::tx_retry_time = 0;
-unsigned char IPMI::tx_slave = 0;
-unsigned int IPMI::tx_length = 0;
-
-#pragma DATA_ALIGN(2)
-unsigned char IPMI::tx_buffer[IPMI::TX_BUFFER_SIZE];
-
-void IPMI::initialize() {
-	UCB0CTLW0 |= UCSWRST;
-	UCB0CTLW0 = UCMODE_3 | UCSSEL_2 | UCMM | UCSWRST;
-	UCB0CTLW1 = UCASTP_1;
-	// 100 kHz transmit rate.
-	UCB0BRW = 10;
-	UCB0I2COA0 = (info.ipmi_address >> 1) | UCOAEN | UCGCEN;
-	// DMA initially gets set up for receiving.
-	ipmi_rx_dma_init();
-
-	// Assign pins to eUSCI.
-	P1SEL0 &= ~(BIT6 | BIT7);
-	P1SEL1 |= (BIT6 | BIT7);
-
-	UCB0CTLW0 &= ~UCSWRST;
-	// Activate start interrupt.
-	UCB0IE |= UCSTTIE;
-}
-
-//< \brief Respond to an IPMI request.
-//<
-//< The standard response to an IPMI request fills
-//< the TX buffer based on RX buffer responses.
-//< The data content of the message is presumed to be filled already.
-void IPMI::respond(unsigned char len) {
-	ipmi_header_t *rq;
-	ipmi_header_t *rsp;
-	unsigned char netFn_dstLUN;
-	unsigned char rqSeq_srcLUN;
-	unsigned char tmp;
-	unsigned char i;
-
-	rq = (ipmi_header_t *) rx_buffer;
-	rsp = (ipmi_header_t *) tx_buffer;
-
-	// len doesn't include check2.
-	len++;
-
-	netFn_dstLUN = (rq->netfn_dstLUN & 0xFC) + 0x4;
-	netFn_dstLUN |= rq->rqSeq_srcLUN & 0x3;
-	rqSeq_srcLUN = (rq->rqSeq_srcLUN & 0xFC) | (rq->netfn_dstLUN & 0x3);
-	tx_slave = rq->srcSA;
-	rsp->netfn_dstLUN = netFn_dstLUN;
-	rsp->rqSeq_srcLUN = rqSeq_srcLUN;
-	rsp->cmd = rq->cmd;
-	rsp->srcSA = info.ipmi_address;
-	tmp = 0;
-	tmp -= tx_slave;
-	tmp -= netFn_dstLUN;
-	rsp->check1 = tmp;
-	// Check2 goes from byte 2 to byte before last (len-2)
-	// e.g. if a min 7 byte message, go from byte 2 to byte 5.
-	tmp = 0;
-	for (i=2;i<len-1;i++) {
-		tmp -= tx_buffer[i];
-	}
-	tx_buffer[len-1] = tmp;
-	ipmi_tx_state = ipmi_TX_STARTED;
-	ipmi_rx_state = ipmi_RX_TRANSMITTING;
-	tx_length = len;
-}
-
-bool IPMI::handle_app_netfn() {
-	ipmi_header_t *rq;
-	unsigned char *data;
-	unsigned int len;
-
-	rq = (ipmi_header_t *) rx_buffer;
-	data = tx_buffer + sizeof(ipmi_header_t);
-	if (rq->cmd == IPMI_APP_GET_DEVICE_ID) {
-		ui.logputln("IPMI> GET_DEVICE_ID");
-		data = thisDevice.copy_device_id(data);
-		len = data - tx_buffer;
-		respond(len);
-		return true;
-	}
-	if (rq->cmd == IPMI_APP_GET_SELF_TEST_RESULTS) {
-		ui.logputln("IPMI> GET_SELF_TEST_RESULTS");
-		*data++ = IPMI_COMPLETION_OK;
-		*data++ = 0x56;
-		*data++ = 0x00;
-		len = data - tx_buffer;
-		respond(len);
-		return true;
-	}
-	return handle_unknown_netfn();
-}
-
-bool IPMI::handle_sensor_netfn() {
-	ipmi_header_t *rq;
-	unsigned char *data;
-	unsigned char *rqdata;
-	unsigned int len;
-	unsigned char rx_length;
-
-	rq = (ipmi_header_t *) rx_buffer;
-	rqdata = rx_buffer + sizeof(ipmi_header_t);
-	data = tx_buffer + sizeof(ipmi_header_t);
-	rx_length = RX_BUFFER_SIZE - rx_buffer_remaining;
-
-	if (rq->cmd == IPMI_SENSOR_GET_DEVICE_SDR_INFO) {
-		unsigned char operation;
-
-		if (rx_length - IPMI_MIN_MESSAGE_LENGTH) operation = rqdata[0];
-		else operation = 0;
-		ui.logprintln("IPMI> GET_DEVICE_SDR_INFO %X", operation);
-		data = thisDevice.copy_sdr_info(operation, data);
-		len = data - tx_buffer;
-		respond(len);
-		return true;
-	}
-	if (rq->cmd == IPMI_SENSOR_RESERVE_DEVICE_SDR_REPOSITORY) {
-		ui.logputln("IPMI> RESERVE_DEVICE_SDR_REPOSITORY");
-		data = thisDevice.reserve_device_sdr_repository(data);
-		len = data - tx_buffer;
-		respond(len);
-		return true;
-	}
-	if (rq->cmd == IPMI_SENSOR_GET_DEVICE_SDR) {
-		unsigned int sdr;
-		unsigned char offset;
-		unsigned char bytes;
-
-		if (rx_length - IPMI_MIN_MESSAGE_LENGTH < 6) {
-			*data++ = IPMI_COMPLETION_INVALID_DATA_FIELD;
-			len = data - tx_buffer;
-			respond(len);
-			return true;
-		}
-		sdr = rqdata[2] + (rqdata[3] << 8);
-		offset = rqdata[4];
-		bytes = rqdata[5];
-		ui.logprintln("IPMI> GET_DEVICE_SDR %u %u %u", sdr, offset, bytes);
-		data = thisDevice.copy_sdr(sdr, offset, bytes, data);
-		len = data - tx_buffer;
-		respond(len);
-		return true;
-	}
-	if (rq->cmd == IPMI_SENSOR_GET_SENSOR_READING) {
-		unsigned int sensor;
-		if (!(rx_length - IPMI_MIN_MESSAGE_LENGTH)) {
-			*data++ = IPMI_COMPLETION_INVALID_DATA_FIELD;
-			len = data - tx_buffer;
-			respond(len);
-			return true;
-		}
-		sensor = rqdata[0];
-		ui.logprintln("IPMI> GET_SENSOR_READING %u", sensor);
-		data = thisDevice.copy_sensor_reading(sensor, data);
-		len = data - tx_buffer;
-		respond(len);
-		return true;
-	}
-	return handle_unknown_netfn();
-}
-
-bool IPMI::handle_oem_netfn() {
-	return handle_unknown_netfn();
-}
-
-bool IPMI::handle_unknown_netfn() {
-	ipmi_header_t *rq;
-	unsigned char *data;
-	unsigned int len;
-
-	rq = (ipmi_header_t *) rx_buffer;
-	data = tx_buffer + sizeof(ipmi_header_t);
-	*data++ = IPMI_COMPLETION_INVALID;
-	len = data - tx_buffer;
-	respond(len);
-	return true;
-}
-
-bool IPMI::handle_message() {
-	ipmi_header_t *p;
-	unsigned char netfn;
-	unsigned char lun;
-
-	p = (ipmi_header_t *) rx_buffer;
-	netfn = (p->netfn_dstLUN & 0xFC) >> 2;
-	lun = (p->netfn_dstLUN & 0x3);
-	if (netfn & 0x1) {
-		// This is a response. Maybe handle these
-		// later or something, if I decide to do
-		// something like get system times or something.
-		return false;
-	}
-	if (lun) {
-		return handle_unknown_netfn();
-	}
-	switch (__even_in_range(netfn, 0x3E)) {
-	case 0x04:
-		return handle_sensor_netfn();
-	case 0x06:
-		return handle_app_netfn();
-	case 0x30:
-		return handle_oem_netfn();
-	case 0x00:
-	case 0x02:
-	case 0x08:
-	case 0x0A:
-	case 0x0C:
-	case 0x0E:
-	case 0x10:
-	case 0x12:
-	case 0x14:
-	case 0x16:
-	case 0x18:
-	case 0x1A:
-	case 0x1C:
-	case 0x1E:
-	case 0x20:
-	case 0x22:
-	case 0x24:
-	case 0x26:
-	case 0x28:
-	case 0x2A:
-	case 0x2C:
-	case 0x2E:
-	case 0x32:
-	case 0x34:
-	case 0x36:
-	case 0x38:
-	case 0x3A:
-	case 0x3C:
-	case 0x3E:
-		return handle_unknown_netfn();
-	default:
-		__never_executed();
-	}
-}
-
-bool IPMI::validate_message(unsigned char len) {
-	unsigned char check;
-	ipmi_header_t *p;
-	unsigned char *data;
-	unsigned char *p2;
-
-	if (len < IPMI_MIN_MESSAGE_LENGTH) return false;
-	p = (ipmi_header_t *) rx_buffer;
-	data = rx_buffer + sizeof(ipmi_header_t);
-	check = info.ipmi_address + p->netfn_dstLUN + p->check1;
-	if (check) {
-		// HACK TO SUPPORT GE BMC's BROADCAST MODE
-		// GE's BMC screws up the transmit pointer when
-		// doing broadcast mode, so it ends up overwriting
-		// the netFn/LUN with the check of the first two
-		// bytes (0 and rsSA).
-		// Then rqSA gets duplicated (again, due to pointer screwup).
-		if (len > IPMI_MIN_MESSAGE_LENGTH) return false;
-
-		check = info.ipmi_address + p->netfn_dstLUN;
-		if (check) return false;
-		if (p->check1 != p->srcSA) return false;
-		check = p->check1 + p->srcSA + p->rqSeq_srcLUN + p->cmd + *data;
-		if (check) return false;
-		// OK, it's fine. Fix the screwup.
-		p->netfn_dstLUN = 0x18;
-		return true;
-	}
-	check = p->srcSA + p->rqSeq_srcLUN + p->cmd;
-	// Get pointer to end of data. Add 1 because
-	// IPMI_MIN_MESSAGE_LENGTH includes the check2 byte.
-	// So if the message length is 6, this is
-	// data + 6 - 6 + 1, or data + 1 (check byte).
-	p2 = data + len - IPMI_MIN_MESSAGE_LENGTH + 1;
-	do {
-		check += *data++;
-	} while (data != p2);
-	if (check) return false;
-	return true;
-}
-
-bool IPMI::tx_process() {
-	unsigned int cur_tick;
-
-	switch(__even_in_range(ipmi_tx_state, ipmi_TX_STATE_MAX)) {
-	case ipmi_TX_IDLE: return false;
-	case ipmi_TX_STARTED:
-ipmi_TX_STARTED_process:
-		if (tx_length == 0) {
-			ui.logputln("IPMI> zero length msg??");
-			ipmi_tx_state = ipmi_TX_IDLE;
-			return false;
-		}
-		ipmi_tx_state = ipmi_TX_TRANSMITTING;
-		// TX begin. Address is in ipmi_tx_address,
-		// and length is in ipmi_tx_length.
-		DMA1SA = (__SFR_FARPTR) (unsigned long) tx_buffer;
-		DMA1DA = (__SFR_FARPTR) (unsigned long) &UCB0TXBUF;
-		DMA1SZ = tx_length;
-		DMACTL0 = (19 << 8) | (DMACTL0 & 0xFF);
-		DMA1CTL = DMALEVEL | DMASRCBYTE | DMADSTBYTE | DMASRCINCR_3 | DMADSTINCR_0 | DMADT_0;
-		// Put eUSCI_B0 in reset, switch to master mode and transmit mode.
-		UCB0CTLW0 |= UCSWRST;
-		UCB0CTLW0 |= (UCMST | UCTR);
-		UCB0TBCNT = tx_length;
-		UCB0CTLW0 &= ~UCSWRST;
-		UCB0IE = UCBCNTIFG | UCALIFG | UCNACKIFG;
-		// Issue start.
-		UCB0I2CSA = (tx_slave>>1);
-		UCB0CTLW0 |= UCTXSTT;
-		// Start DMA. We need to check this!!
-		DMA1CTL |= DMAEN;
-
-		return true;
-	case ipmi_TX_ARBITRATION_LOST:
-	case ipmi_TX_NACKED:
-		ui.logprintln("IPMI> tx %u/%u fail %X", ++tx_retry_count, TX_RETRY_MAX, ipmi_tx_state);
-		if (tx_retry_count == TX_RETRY_MAX) {
-			// Abandoning attempt.
-			ipmi_tx_state = ipmi_TX_COMPLETE;
-			goto ipmi_TX_COMPLETE_process;
-		}
-		tx_retry_time = clock.ticks + 2;
-		ipmi_tx_state = ipmi_TX_RETRY_WAIT;
-		return true;
-	case ipmi_TX_RETRY_WAIT:
-		cur_tick = clock.ticks;
-		if (cur_tick > tx_retry_time) {
-			if (cur_tick - tx_retry_time < 0x8000) {
-				ui.logprintln("IPMI> retry at %u", tx_retry_time);
-				ipmi_tx_state = ipmi_TX_STARTED;
-				goto ipmi_TX_STARTED_process;
-			}
-		}
-		return true;
-	case ipmi_TX_COMPLETE:
-	ipmi_TX_COMPLETE_process:
-		if (UCB0STATW & UCBBUSY) return true;
-		ipmi_rx_dma_init();
-		return false;
-	case ipmi_TX_TRANSMITTING:
-		return true;
-	default:
-		__never_executed();
-	}
-}
-
-void IPMI::process() {
-	unsigned int len;
-
-	switch(__even_in_range(ipmi_rx_state, ipmi_RX_STATE_MAX)) {
-	case ipmi_RX_IDLE:
-	case ipmi_RX_RECEIVING:
-		return;
-	case ipmi_RX_PAUSED:
-		// We have a message to process.
-		len = RX_BUFFER_SIZE - rx_buffer_remaining;
-		if (!validate_message(len)) {
-			ipmi_rx_reset();
-			return;
-		} else {
-			ipmi_header_t *p;
-			p = (ipmi_header_t *) rx_buffer;
-			ipmi_rx_state = ipmi_RX_PROCESSING;
-		}
-	case ipmi_RX_PROCESSING:
-		if (!handle_message()) {
-			ipmi_rx_reset();
-			return;
-		}
-		if (ipmi_rx_state != ipmi_RX_TRANSMITTING) return;
-		tx_retry_count = 0;
-	case ipmi_RX_TRANSMITTING:
-		if (!tx_process())
-			ipmi_rx_reset();
-	}
-}
-
-// Cleanups from v1:
-// ipmi_address is the 8-bit address. It only gets programmed once, so a shift
-// at that point is easy. Compares happen all the time.
-// Instead of an rx_buffer_len we use rx_buffer_remaining. Reduces ISR instructions.
-// (We can't use the byte counter since general calls screw it up).
-//
-// Note we have to use UCB0RXBUF_L to avoid register usage.
-#pragma vector=USCI_B0_VECTOR
-__interrupt void IPMI_Handler() {
-	switch(__even_in_range(UCB0IV, 0x1E)) {
-	case 0x00: return;	// no interrupt
-	case 0x02: 			// ALIFG
-		IPMI::ipmi_tx_state = IPMI::ipmi_TX_ARBITRATION_LOST;
-		DMA1CTL &= ~DMAEN;
-		UCB0IE = 0;
-		asm("	mov.b	#0x00, r4");
-		// And wake up.
-		__bic_SR_register_on_exit(LPM0_bits);
-		return;
-	case 0x04:
-		IPMI::ipmi_tx_state = IPMI::ipmi_TX_NACKED;
-		UCB0CTLW0 |= UCTXSTP;
-		DMA1CTL &= ~DMAEN;
-		UCB0IE = 0;
-		asm("	mov.b	#0x00, r4");
-		// And wake up.
-		__bic_SR_register_on_exit(LPM0_bits);
-		return;  // NACKIFG
-	case 0x06: 			// STTIFG
-		if (IPMI::ipmi_rx_state != IPMI::ipmi_RX_IDLE) {
-			// Repeated Start.
-			if (DMA1SZ != IPMI::RX_BUFFER_SIZE) {
-				// We have data, but we can't disable ourself yet.
-				IPMI::ipmi_rx_state = IPMI::ipmi_RX_PAUSED;
-				// We have to grab this before disabling DMA.
-				IPMI::rx_buffer_remaining = DMA1SZ;
-				DMA1CTL &= ~DMAEN;
-				UCB0CTLW0 |= UCTXNACK;
-				UCB0IE = UCSTPIE | UCSTTIE | UCRXIE;
-				UCB0STAT &= ~UCGC;
-				return;
-			}
-			DMA1CTL &= ~DMAEN;
-			// No data. Continue.
-			IPMI::ipmi_rx_state = IPMI::ipmi_RX_IDLE;
-		}
-		// Is it a general call?
-		if (UCB0STAT & UCGC) {
-			// Respond to stop, start, and receive.
-			UCB0IE = UCSTPIE | UCSTTIE | UCRXIE;
-			// State doesn't change. Don't touch DMA either
-			// until we're ready to really accept.
-			return;
-		}
-		// No, so initialize DMA.
-		UCB0IE = UCSTPIE | UCSTTIE;
-		// DMA is set up so that the receiver can do it as quickly as possible.
-		DMA1CTL |= DMAEN;
-		// STPIFG will fire when the message is completely received.
-		IPMI::ipmi_rx_state = IPMI::ipmi_RX_RECEIVING;
-		return;
-	case 0x08: 			// STPIFG
-		// Received STOP. Process message.
-		if (IPMI::ipmi_rx_state == IPMI::ipmi_RX_RECEIVING) {
-			if (DMA1SZ != IPMI::RX_BUFFER_SIZE) {
-				IPMI::ipmi_rx_state = IPMI::ipmi_RX_PAUSED;
-				IPMI::rx_buffer_remaining = DMA1SZ;
-				DMA1CTL &= ~DMAEN;
-				// Shut off receiver. SWRST resets IE.
-				UCB0CTLW0 |= UCSWRST;
-				UCB0I2COA0 &= ~(UCOAEN | UCGCEN);
-				UCB0CTLW0 &= ~UCSWRST;
-				asm("	mov.b	#0x00, r4");
-				// And wake up.
-				__bic_SR_register_on_exit(LPM0_bits);
-				return;
-			}
-			// No data, so revert to STTIFG.
-			IPMI::ipmi_rx_state = IPMI::ipmi_RX_IDLE;
-		}
-		if (IPMI::ipmi_rx_state == IPMI::ipmi_RX_PAUSED) {
-			// We hit a repeated start.
-			UCB0CTLW0 |= UCSWRST;
-			UCB0I2COA0 &= ~(UCOAEN | UCGCEN);
-			UCB0CTLW0 &= ~UCSWRST;
-			asm("	mov.b	#0x00, r4");
-			// And wake up.
-			__bic_SR_register_on_exit(LPM0_bits);
-			return;
-		}
-		// If we weren't receiving, we just need to reset back to STTIFG.
-		UCB0IE = UCSTTIE;
-		return;
-	case 0x0A:			// RXIFG3
-	case 0x0C:			// TXIFG3
-	case 0x0E:			// RXIFG2
-	case 0x10:			// TXIFG2
-	case 0x12:			// RXIFG1
-	case 0x14:			// TXIFG1
-		return;
-	case 0x16:			// RXIFG0
-		// If it was a general call, we need to check our address.
-		if (UCB0STATW & UCGC) {
-			if (UCB0RXBUF_L == info.ipmi_address) {
-				// Yes, it's ours. Enable start/stop interrupts, and set our state to receiving.
-				UCB0IE = UCSTPIE | UCSTTIE;
-				DMA1CTL |= DMAEN;
-				IPMI::ipmi_rx_state = IPMI::ipmi_RX_RECEIVING;
-				return;
-			}
-			UCB0STATW &= ~UCGC;
-		}
-		// Otherwise, just nacknacknack
-		UCB0CTLW0 |= UCTXNACK;
-		return;
-	case 0x18:			// TXIFG0
-		return;
-	case 0x1A:			// BCNTIFG
-		IPMI::ipmi_tx_state = IPMI::ipmi_TX_COMPLETE;
-		UCB0CTLW0 |= UCTXSTP;
-		DMA1CTL &= ~DMAEN;
-		UCB0IE = 0;
-		asm("	mov.b	#0x00, r4");
-		// And wake up.
-		__bic_SR_register_on_exit(LPM0_bits);
-		return;
-	case 0x1C:			// SCLLOW
-		return;
-	case 0x1E:			// 9th bit.
-		return;
-	default:
-		__never_executed();
-	}
-}
+#include <msp430.h>
+#include "ipmiv2.h"
+#include "ui.h"
+#include "clock.h"
+#include "info.h"
+#include "ipmi_device_specific.h"
+#include "sel.h"
+#include "twi.h"
+#include "platform.h"
+#include "latency.h"
+
+IPMI ipmi;
+
+IPMI::ipmi_rx_state_t IPMI::ipmi_rx_state = ipmi_RX_IDLE;
+IPMI::ipmi_process_state_t IPMI::ipmi_process_state = ipmi_PROCESS_IDLE;
+unsigned char IPMI::rx_buffer[IPMI::RX_SLOTS][IPMI::RX_SLOT_SIZE];
+unsigned char IPMI::rx_slot_length[IPMI::RX_SLOTS];
+unsigned char IPMI::rx_slot_wr = 0;
+unsigned char IPMI::rx_slot_rd = 0;
+volatile unsigned char IPMI::rx_slots_used = 0;
+unsigned char *IPMI::rx_msg = IPMI::rx_buffer[0];
+unsigned char IPMI::rx_msg_length = 0;
+
+IPMI::ipmi_tx_state_t IPMI::ipmi_tx_state = ipmi_TX_IDLE;
+unsigned char IPMI::tx_retry_count = 0;
+unsigned int IPMI::tx_retry_time = 0;
+unsigned int IPMI::rx_slot_time[IPMI::RX_SLOTS];
+unsigned char IPMI::rx_slot_ticks[IPMI::RX_SLOTS];
+unsigned int IPMI::rx_stop_time;
+unsigned int IPMI::handle_time;
+unsigned int IPMI::tx_start_time;
+volatile unsigned int IPMI::tx_done_time;
+unsigned char IPMI::rx_stop_ticks;
+unsigned char IPMI::handle_ticks;
+unsigned char IPMI::tx_start_ticks;
+volatile unsigned char IPMI::tx_done_ticks;
+bool IPMI::latency_valid = false;
+IPMI::ipmi_stats_t IPMI::stats;
+const char *IPMI::stats_names[IPMI::NUM_STATS] = {
+		"RX frames",
+		"RX queue full",
+		"check1 errors",
+		"check2 errors",
+		"GE fixups",
+		"NACKs",
+		"arbitration lost",
+		"retries",
+		"abandoned",
+		"unknown commands",
+		"request timeouts",
+		"node busy"
+};
+// Fast requests: 100 ms, and not with every slot full (new frames get
+// NACKed then, so answer Node Busy and free one quickly). Bridged ones:
+// 200 ms, and only with nothing waiting behind them (they hold up the
+// queue).
+const IPMI::ipmi_latency_budget_t IPMI::latency_budget[IPMI::LATENCY_CLASSES] = {
+		{ 12500, IPMI::RX_SLOTS - 1 },
+		{ 25000, 1 }
+};
+// Starting guesses: 2 ms and 20 ms.
+unsigned int IPMI::service_estimate[IPMI::LATENCY_CLASSES] = { 250, 2500 };
+unsigned char IPMI::rx_class = IPMI::class_FAST;
+bool IPMI::rx_busy = false;
+IPMI::ipmi_retry_budget_t IPMI::retry_budget[IPMI::RETRY_DESTINATIONS];
+unsigned char IPMI::retry_budget_wr = 0;
+unsigned int IPMI::retry_refill_time = 0;
+unsigned int IPMI::backoff_state = 1;
+unsigned char IPMI::tx_slave = 0;
+unsigned int IPMI::tx_length = 0;
+const unsigned char *IPMI::tx_body = 0;
+unsigned char IPMI::tx_body_length = 0;
+volatile unsigned char IPMI::tx_segment = 0;
+const unsigned char *IPMI::tx_address = 0;
+
+unsigned char *IPMI::tx_buffer = IPMI::response_cache[0].data;
+
+#pragma DATA_ALIGN(2)
+IPMI::ipmi_cached_response_t IPMI::response_cache[IPMI::RESPONSE_CACHE_ENTRIES];
+unsigned char IPMI::response_cache_wr = 0;
+
+IPMI::ipmi_outbound_t IPMI::outbound[IPMI::OUTBOUND_SLOTS];
+unsigned char IPMI::outbound_rd = 0;
+unsigned char IPMI::outbound_count = 0;
+unsigned char IPMI::rq_seq = 0;
+IPMI::ipmi_pending_request_t IPMI::pending[IPMI::PENDING_REQUESTS];
+unsigned char IPMI::pending_count = 0;
+unsigned int IPMI::bridge_deadline;
+bool IPMI::bridge_started = false;
+unsigned char IPMI::bridge_slave;
+unsigned char IPMI::bridge_wr_count;
+unsigned char IPMI::bridge_rd_count;
+unsigned char IPMI::event_receiver = 0x20;
+unsigned char IPMI::event_receiver_lun = 0;
+
+// Get Self Test Results response image.
+typedef struct ipmi_self_test_response {
+	IPMI::ipmi_response_t rsp;
+	unsigned char completion;
+	unsigned char result[2];
+	unsigned char check2;
+} ipmi_self_test_response_t;
+
+#pragma PERSISTENT
+ipmi_self_test_response_t self_test_response = {
+		.rsp = { .data_length = 3, .header = { .cmd = IPMI::IPMI_APP_GET_SELF_TEST_RESULTS } },
+		.completion = IPMI::IPMI_COMPLETION_OK,
+		.result = { 0x56, 0x00 }
+};
+
+void IPMI::initialize() {
+	UCB0CTLW0 |= UCSWRST;
+	UCB0CTLW0 = UCMODE_3 | UCSSEL_2 | UCMM | UCSWRST;
+	UCB0CTLW1 = UCASTP_1;
+	// 100 kHz transmit rate.
+	UCB0BRW = 10;
+	UCB0I2COA0 = (info.ipmi_address >> 1) | UCOAEN | UCGCEN;
+	// DMA initially gets set up for receiving.
+	ipmi_rx_dma_init();
+
+	// Assign pins to eUSCI.
+	P1SEL0 &= ~(BIT6 | BIT7);
+	P1SEL1 |= (BIT6 | BIT7);
+
+	UCB0CTLW0 &= ~UCSWRST;
+	// Activate start interrupt.
+	UCB0IE |= UCSTTIE;
+
+	compute_raw_check(&self_test_response.rsp);
+	backoff_initialize();
+}
+
+//< \brief Seed the backoff generator.
+//<
+//< The TLV die record (lot/wafer ID and die position) is unique
+//< per chip, and the IPMB address is unique per shelf slot.
+void IPMI::backoff_initialize() {
+	unsigned char *p;
+	unsigned char i;
+
+	p = platform_tag_find(TLV_DIERECORD);
+	// Skip tag and length.
+	p += 2;
+	backoff_state = info.ipmi_address;
+	for (i=0;i<8;i++) {
+		backoff_state = ((backoff_state << 5) | (backoff_state >> 11)) ^ p[i];
+	}
+	if (!backoff_state) backoff_state = 1;
+	// No destinations yet. IPMB addresses are even, so this never matches.
+	for (i=0;i<RETRY_DESTINATIONS;i++) retry_budget[i].slave = 0xFF;
+}
+
+//< \brief Next pseudorandom number (16-bit xorshift).
+unsigned int IPMI::backoff_random() {
+	backoff_state ^= backoff_state << 7;
+	backoff_state ^= backoff_state >> 9;
+	backoff_state ^= backoff_state << 8;
+	return backoff_state;
+}
+
+unsigned char IPMI::backoff_max() {
+	unsigned char max = info.ipmi_backoff_max;
+	if (max == 0x00 || max == 0xFF) return BACKOFF_MAX_DEFAULT;
+	return max;
+}
+
+//< \brief Longest message we send, not counting the slave address.
+//<
+//< info.ipmi_message_max counts the address, like the IPMB limit.
+//< Anything not longer than IPMB's 32 bytes (including 0 or erased,
+//< 0xFF) keeps to IPMB.
+unsigned char IPMI::tx_message_max() {
+	unsigned char max = info.ipmi_message_max;
+	if (max <= TX_BUFFER_MAX + 1 || max == 0xFF) return TX_BUFFER_MAX;
+	if (max > TX_MESSAGE_LIMIT + 1) return TX_MESSAGE_LIMIT;
+	return max - 1;
+}
+
+unsigned char IPMI::retry_budget_max() {
+	unsigned char max = info.ipmi_retry_budget;
+	if (max == 0x00 || max == 0xFF) return RETRY_BUDGET_DEFAULT;
+	return max;
+}
+
+//< \brief Spend one retry on a destination. False if it has none left.
+//<
+//< Destinations are tracked in a small table: a new one replaces
+//< the oldest entry, with a full budget.
+bool IPMI::retry_budget_take(unsigned char slave) {
+	ipmi_retry_budget_t *entry;
+	unsigned char i;
+
+	for (i=0;i<RETRY_DESTINATIONS;i++) {
+		if (retry_budget[i].slave == slave) break;
+	}
+	if (i == RETRY_DESTINATIONS) {
+		entry = &retry_budget[retry_budget_wr];
+		if (++retry_budget_wr == RETRY_DESTINATIONS) retry_budget_wr = 0;
+		entry->slave = slave;
+		entry->tokens = retry_budget_max();
+	} else entry = &retry_budget[i];
+	if (!entry->tokens) return false;
+	entry->tokens--;
+	return true;
+}
+
+//< \brief Give every destination one retry back, once a second.
+void IPMI::retry_budget_refill() {
+	unsigned char max;
+	unsigned char i;
+
+	if (!clock.time_has_passed(retry_refill_time)) return;
+	retry_refill_time = clock.ticks + clock.ticks_per_second;
+	max = retry_budget_max();
+	for (i=0;i<RETRY_DESTINATIONS;i++) {
+		if (retry_budget[i].tokens < max) retry_budget[i].tokens++;
+	}
+}
+
+//< \brief Fill in the connection header of a response.
+//<
+//< Fills in everything except cmd, and sets the slave
+//< to transmit to. Returns the check2 contribution of
+//< the header bytes (srcSA and rqSeq/srcLUN).
+unsigned char IPMI::fill_response_header(ipmi_header_t *rsp) {
+	ipmi_header_t *rq;
+	unsigned char netFn_dstLUN;
+	unsigned char rqSeq_srcLUN;
+	unsigned char tmp;
+
+	rq = (ipmi_header_t *) rx_msg;
+
+	netFn_dstLUN = (rq->netfn_dstLUN & 0xFC) + 0x4;
+	netFn_dstLUN |= rq->rqSeq_srcLUN & 0x3;
+	rqSeq_srcLUN = (rq->rqSeq_srcLUN & 0xFC) | (rq->netfn_dstLUN & 0x3);
+	tx_slave = rq->srcSA;
+	rsp->netfn_dstLUN = netFn_dstLUN;
+	rsp->rqSeq_srcLUN = rqSeq_srcLUN;
+	rsp->srcSA = info.ipmi_address;
+	tmp = 0;
+	tmp -= tx_slave;
+	tmp -= netFn_dstLUN;
+	rsp->check1 = tmp;
+	tmp = 0;
+	tmp -= info.ipmi_address;
+	tmp -= rqSeq_srcLUN;
+	return tmp;
+}
+
+//< \brief Respond to an IPMI request.
+//<
+//< The standard response to an IPMI request fills
+//< the TX buffer based on RX buffer responses.
+//< The data content of the message is presumed to be filled already.
+void IPMI::respond(unsigned char len) {
+	respond_segmented(len, 0, 0);
+}
+
+//< \brief Check2 contribution of a response body.
+unsigned char IPMI::compute_body_check(const unsigned char *body,
+									   unsigned char body_length) {
+	unsigned char tmp;
+	unsigned char i;
+
+	tmp = 0;
+	for (i=0;i<body_length;i++) {
+		tmp -= body[i];
+	}
+	return tmp;
+}
+
+//< \brief Respond to an IPMI request, with a body sent from elsewhere.
+//<
+//< The first len bytes of the response come from the TX buffer, followed
+//< by body_length bytes straight from body (e.g. an SDR in FRAM),
+//< followed by check2. The DMA switches segments as it goes, so the body
+//< is never copied.
+void IPMI::respond_segmented(unsigned char len,
+							 const unsigned char *body,
+							 unsigned char body_length) {
+	ipmi_header_t *rq;
+	ipmi_header_t *rsp;
+	ipmi_cached_response_t *entry;
+	unsigned char body_check;
+	unsigned char tmp;
+	unsigned char i;
+
+	rq = (ipmi_header_t *) rx_msg;
+	rsp = (ipmi_header_t *) tx_buffer;
+
+	rsp->cmd = rq->cmd;
+	tmp = fill_response_header(rsp);
+	// Check2 goes from byte 2 to the byte before check2.
+	// Bytes 2 and 3 were already done by fill_response_header.
+	for (i=4;i<len;i++) {
+		tmp -= tx_buffer[i];
+	}
+	body_check = compute_body_check(body, body_length);
+	tmp += body_check;
+	// check2 always sits right after the TX buffer portion.
+	tx_buffer[len] = tmp;
+	// Segmented messages leave check2 out of tx_length.
+	if (!body_length) len++;
+	ipmi_tx_state = ipmi_TX_STARTED;
+	ipmi_process_state = ipmi_PROCESS_TRANSMITTING;
+	tx_address = tx_buffer;
+	tx_length = len;
+	tx_body = body;
+	tx_body_length = body_length;
+
+	// Keep it in the cache, and move tx_buffer on to the next entry.
+	entry = &response_cache[response_cache_wr];
+	entry->ticks = clock.ticks;
+	entry->length = len;
+	entry->body = body;
+	entry->body_length = body_length;
+	entry->body_check = body_check;
+	entry->srcSA = rq->srcSA;
+	entry->rqSeq_srcLUN = rq->rqSeq_srcLUN;
+	entry->netfn_dstLUN = rq->netfn_dstLUN;
+	entry->cmd = rq->cmd;
+	if (++response_cache_wr == RESPONSE_CACHE_ENTRIES) response_cache_wr = 0;
+	entry = &response_cache[response_cache_wr];
+	entry->length = 0;
+	tx_buffer = entry->data;
+}
+
+//< \brief Retransmit a cached response to a duplicate request.
+//<
+//< A body is only kept as a pointer, and it may have changed since
+//< (SDR, FRU and histogram bodies live in FRAM), so check2 is redone
+//< for the body as it is now.
+//< Returns true if the request matched a cached response.
+bool IPMI::respond_cached() {
+	ipmi_header_t *rq;
+	ipmi_cached_response_t *entry;
+	unsigned char body_check;
+	unsigned char i;
+
+	rq = (ipmi_header_t *) rx_msg;
+	entry = response_cache;
+	for (i=0;i<RESPONSE_CACHE_ENTRIES;i++,entry++) {
+		if (!entry->length) continue;
+		if (clock.ticks - entry->ticks >= RESPONSE_CACHE_TICKS) {
+			entry->length = 0;
+			continue;
+		}
+		if (entry->srcSA != rq->srcSA) continue;
+		if (entry->rqSeq_srcLUN != rq->rqSeq_srcLUN) continue;
+		if (entry->netfn_dstLUN != rq->netfn_dstLUN) continue;
+		if (entry->cmd != rq->cmd) continue;
+		ui.logprintln("IPMI> dup %X/%X from %X", rq->netfn_dstLUN, rq->cmd, rq->srcSA);
+		if (entry->body_length) {
+			body_check = compute_body_check(entry->body, entry->body_length);
+			entry->data[entry->length] += body_check - entry->body_check;
+			entry->body_check = body_check;
+		}
+		tx_slave = rq->srcSA;
+		tx_address = entry->data;
+		tx_length = entry->length;
+		tx_body = entry->body;
+		tx_body_length = entry->body_length;
+		ipmi_tx_state = ipmi_TX_STARTED;
+		ipmi_process_state = ipmi_PROCESS_TRANSMITTING;
+		return true;
+	}
+	return false;
+}
+
+//< \brief Respond to an IPMI request with a fixed response image.
+//<
+//< Only the header and check2 are patched: the image
+//< is then transmitted directly from FRAM.
+void IPMI::prepare_fixed_response(ipmi_response_t *rsp) {
+	unsigned char *p;
+	unsigned char tmp;
+
+	p = (unsigned char *) &(rsp->header);
+	tmp = fill_response_header(&(rsp->header));
+	tmp += rsp->raw_check;
+	p[sizeof(ipmi_header_t) + rsp->data_length] = tmp;
+	ipmi_tx_state = ipmi_TX_STARTED;
+	ipmi_process_state = ipmi_PROCESS_TRANSMITTING;
+	tx_address = p;
+	// header + data + check2
+	tx_length = sizeof(ipmi_header_t) + rsp->data_length + 1;
+	tx_body_length = 0;
+}
+
+//< \brief Compute the partial check2 of a fixed response image.
+//<
+//< Needs to be called whenever the data in the image changes.
+void IPMI::compute_raw_check(ipmi_response_t *rsp) {
+	unsigned char *p;
+	unsigned char tmp;
+	unsigned char i;
+
+	p = (unsigned char *) &(rsp->header);
+	tmp = 0;
+	tmp -= rsp->header.cmd;
+	p += sizeof(ipmi_header_t);
+	for (i=0;i<rsp->data_length;i++) {
+		tmp -= *p++;
+	}
+	rsp->raw_check = tmp;
+}
+
+//< \brief Get Device ID.
+bool IPMI::handle_get_device_id() {
+	ui.logputln("IPMI> GET_DEVICE_ID");
+	prepare_fixed_response(thisDevice.device_id_response());
+	return true;
+}
+
+//< \brief Get Self Test Results.
+bool IPMI::handle_get_self_test_results() {
+	ui.logputln("IPMI> GET_SELF_TEST_RESULTS");
+	prepare_fixed_response(&self_test_response.rsp);
+	return true;
+}
+
+//< \brief Get Device SDR Info.
+bool IPMI::handle_get_device_sdr_info() {
+	unsigned char operation;
+
+	if (rx_msg_length - IPMI_MIN_MESSAGE_LENGTH) operation = rx_msg[sizeof(ipmi_header_t)];
+	else operation = 0;
+	ui.logprintln("IPMI> GET_DEVICE_SDR_INFO %X", operation);
+	// If 'operation' = 1, we return the total count (all LUNs).
+	// We only have 1 LUN, so it's always the same.
+	prepare_fixed_response(thisDevice.sdr_info_response());
+	return true;
+}
+
+//< \brief Reserve Device SDR Repository.
+bool IPMI::handle_reserve_device_sdr_repository() {
+	unsigned char *data;
+
+	ui.logputln("IPMI> RESERVE_DEVICE_SDR_REPOSITORY");
+	data = tx_buffer + sizeof(ipmi_header_t);
+	data = thisDevice.reserve_device_sdr_repository(data);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Get Device SDR.
+//<
+//< The record itself goes out straight from FRAM.
+bool IPMI::handle_get_device_sdr() {
+	unsigned char *data;
+	unsigned char *rqdata;
+	const unsigned char *body;
+	unsigned char body_length;
+	unsigned int reservation;
+	unsigned int sdr;
+	unsigned char offset;
+	unsigned char bytes;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	reservation = rqdata[0] + (rqdata[1] << 8);
+	sdr = rqdata[2] + (rqdata[3] << 8);
+	offset = rqdata[4];
+	bytes = rqdata[5];
+	ui.logprintln("IPMI> GET_DEVICE_SDR %u %u %u", sdr, offset, bytes);
+	data = thisDevice.copy_sdr(reservation, sdr, offset, bytes, data, &body, &body_length);
+	respond_segmented(data - tx_buffer, body, body_length);
+	return true;
+}
+
+//< \brief Get Sensor Reading.
+//<
+//< The response is encoded when the sensor is sampled: here we
+//< only patch the header.
+bool IPMI::handle_get_sensor_reading() {
+	ipmi_response_t *rsp;
+	unsigned char sensor;
+
+	sensor = rx_msg[sizeof(ipmi_header_t)];
+	ui.logprintln("IPMI> GET_SENSOR_READING %u", sensor);
+	rsp = thisDevice.sensor_reading_response(sensor);
+	if (!rsp) return respond_completion(IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT);
+	prepare_fixed_response(rsp);
+	return true;
+}
+
+//< \brief Set Sensor Hysteresis.
+bool IPMI::handle_set_sensor_hysteresis() {
+	unsigned char *rqdata;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	ui.logprintln("IPMI> SET_SENSOR_HYSTERESIS %u %u %u", rqdata[0], rqdata[2], rqdata[3]);
+	return respond_completion(thisDevice.set_sensor_hysteresis(rqdata[0], rqdata[2], rqdata[3]));
+}
+
+//< \brief Get Sensor Hysteresis.
+bool IPMI::handle_get_sensor_hysteresis() {
+	unsigned char *data;
+	unsigned char sensor;
+
+	data = tx_buffer + sizeof(ipmi_header_t);
+	sensor = rx_msg[sizeof(ipmi_header_t)];
+	ui.logprintln("IPMI> GET_SENSOR_HYSTERESIS %u", sensor);
+	data = thisDevice.copy_sensor_hysteresis(sensor, data);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Set Sensor Thresholds.
+bool IPMI::handle_set_sensor_threshold() {
+	unsigned char *rqdata;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	ui.logprintln("IPMI> SET_SENSOR_THRESHOLD %u %X", rqdata[0], rqdata[1]);
+	return respond_completion(thisDevice.set_sensor_thresholds(rqdata[0], rqdata[1], rqdata + 2));
+}
+
+//< \brief Get Sensor Thresholds.
+bool IPMI::handle_get_sensor_threshold() {
+	unsigned char *data;
+	unsigned char sensor;
+
+	data = tx_buffer + sizeof(ipmi_header_t);
+	sensor = rx_msg[sizeof(ipmi_header_t)];
+	ui.logprintln("IPMI> GET_SENSOR_THRESHOLD %u", sensor);
+	data = thisDevice.copy_sensor_thresholds(sensor, data);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Get FRU Inventory Area Info.
+bool IPMI::handle_get_fru_inventory_area_info() {
+	unsigned char *data;
+	unsigned char fru;
+
+	fru = rx_msg[sizeof(ipmi_header_t)];
+	ui.logprintln("IPMI> GET_FRU_INVENTORY_AREA_INFO %u", fru);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	data = thisDevice.copy_fru_area_info(fru, data);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Read FRU Data.
+//<
+//< The data goes out straight from FRAM.
+bool IPMI::handle_read_fru_data() {
+	unsigned char *data;
+	unsigned char *rqdata;
+	const unsigned char *body;
+	unsigned char body_length;
+	unsigned int offset;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	offset = rqdata[1] + (rqdata[2] << 8);
+	ui.logprintln("IPMI> READ_FRU_DATA %u %u %u", rqdata[0], offset, rqdata[3]);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	data = thisDevice.copy_fru_data(rqdata[0], offset, rqdata[3], data, &body, &body_length);
+	respond_segmented(data - tx_buffer, body, body_length);
+	return true;
+}
+
+//< \brief Write FRU Data.
+bool IPMI::handle_write_fru_data() {
+	unsigned char *data;
+	unsigned char *rqdata;
+	unsigned int offset;
+	unsigned char count;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	offset = rqdata[1] + (rqdata[2] << 8);
+	count = rx_msg_length - IPMI_MIN_MESSAGE_LENGTH - 3;
+	ui.logprintln("IPMI> WRITE_FRU_DATA %u %u %u", rqdata[0], offset, count);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	data = thisDevice.write_fru_data(rqdata[0], offset, rqdata + 3, count, data);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Get SEL Info.
+bool IPMI::handle_get_sel_info() {
+	unsigned char *data;
+	unsigned int free_space;
+
+	ui.logputln("IPMI> GET_SEL_INFO");
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	// SEL version 1.5/2.0.
+	*data++ = 0x51;
+	*data++ = sel.state.count & 0xFF;
+	*data++ = sel.state.count >> 8;
+	free_space = (sel.SEL_ENTRIES - sel.state.count) * sel.ENTRY_SIZE;
+	*data++ = free_space & 0xFF;
+	*data++ = free_space >> 8;
+	*data++ = sel.state.add_time & 0xFF;
+	*data++ = (sel.state.add_time >> 8) & 0xFF;
+	*data++ = (sel.state.add_time >> 16) & 0xFF;
+	*data++ = (sel.state.add_time >> 24) & 0xFF;
+	*data++ = sel.state.erase_time & 0xFF;
+	*data++ = (sel.state.erase_time >> 8) & 0xFF;
+	*data++ = (sel.state.erase_time >> 16) & 0xFF;
+	*data++ = (sel.state.erase_time >> 24) & 0xFF;
+	// Reserve SEL supported, plus overflow flag.
+	*data++ = 0x02 | (sel.state.overflow ? 0x80 : 0x00);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Reserve SEL.
+bool IPMI::handle_reserve_sel() {
+	unsigned char *data;
+	unsigned int reservation;
+
+	reservation = sel.reserve();
+	ui.logprintln("IPMI> RESERVE_SEL %u", reservation);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	*data++ = reservation & 0xFF;
+	*data++ = reservation >> 8;
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Get SEL Entry.
+//<
+//< The reservation only matters for partial reads.
+bool IPMI::handle_get_sel_entry() {
+	unsigned char *data;
+	unsigned char *rqdata;
+	const unsigned char *entry;
+	unsigned int reservation;
+	unsigned int id;
+	unsigned int next_id;
+	unsigned char offset;
+	unsigned char bytes;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	reservation = rqdata[0] + (rqdata[1] << 8);
+	id = rqdata[2] + (rqdata[3] << 8);
+	offset = rqdata[4];
+	bytes = rqdata[5];
+	ui.logprintln("IPMI> GET_SEL_ENTRY %u %u %u", id, offset, bytes);
+	if (offset && !sel.reservation_valid(reservation))
+		return respond_completion(IPMI_COMPLETION_RESERVATION_CANCELLED);
+	if (offset >= sel.ENTRY_SIZE)
+		return respond_completion(IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE);
+	entry = sel.entry(id, &next_id);
+	if (!entry)
+		return respond_completion(IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT);
+	if (bytes > sel.ENTRY_SIZE - offset) bytes = sel.ENTRY_SIZE - offset;
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	*data++ = next_id & 0xFF;
+	*data++ = next_id >> 8;
+	entry += offset;
+	while (bytes--) *data++ = *entry++;
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Add SEL Entry.
+bool IPMI::handle_add_sel_entry() {
+	unsigned char *data;
+	unsigned int id;
+
+	id = sel.add(rx_msg + sizeof(ipmi_header_t));
+	ui.logprintln("IPMI> ADD_SEL_ENTRY %u", id);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	*data++ = id & 0xFF;
+	*data++ = id >> 8;
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Clear SEL.
+//<
+//< Clearing only resets the SEL state, so it always completes at once.
+bool IPMI::handle_clear_sel() {
+	unsigned char *data;
+	unsigned char *rqdata;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	ui.logprintln("IPMI> CLEAR_SEL %X", rqdata[5]);
+	if (!sel.reservation_valid(rqdata[0] + (rqdata[1] << 8)))
+		return respond_completion(IPMI_COMPLETION_RESERVATION_CANCELLED);
+	if (rqdata[2] != 'C' || rqdata[3] != 'L' || rqdata[4] != 'R')
+		return respond_completion(IPMI_COMPLETION_INVALID_DATA_FIELD);
+	if (rqdata[5] == 0xAA) sel.clear();
+	else if (rqdata[5] != 0x00)
+		return respond_completion(IPMI_COMPLETION_INVALID_DATA_FIELD);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	// Erasure completed.
+	*data++ = 0x01;
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Master Write-Read.
+//<
+//< Only private bus 0 (the Twi bus) is supported. The transaction
+//< is run by bridge_process(), so this just checks the request.
+bool IPMI::handle_master_write_read() {
+	unsigned char *rqdata;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	bridge_slave = rqdata[1] >> 1;
+	bridge_rd_count = rqdata[2];
+	bridge_wr_count = rx_msg_length - IPMI_MIN_MESSAGE_LENGTH - 3;
+	ui.logprintln("IPMI> MASTER_WRITE_READ %X %X %u %u", rqdata[0], rqdata[1], bridge_wr_count, bridge_rd_count);
+	if (rqdata[0] != 0x01)
+		return respond_completion(IPMI_COMPLETION_INVALID_DATA_FIELD);
+	if (bridge_rd_count > BRIDGE_READ_MAX)
+		return respond_completion(IPMI_COMPLETION_CANNOT_RETURN_NUMBER_OF_BYTES);
+	if (!bridge_rd_count && !bridge_wr_count)
+		return respond_completion(IPMI_COMPLETION_INVALID_DATA_FIELD);
+	bridge_started = false;
+	bridge_deadline = clock.ticks + BRIDGE_TIMEOUT_TICKS;
+	ipmi_process_state = ipmi_PROCESS_BRIDGING;
+	return true;
+}
+
+//< \brief Run a Master Write-Read on the Twi bus.
+//<
+//< Returns true once the response is ready to transmit. Until then
+//< the request stays at the head of the RX queue.
+bool IPMI::bridge_process() {
+	unsigned char *data;
+
+	data = tx_buffer + sizeof(ipmi_header_t);
+	if (clock.time_has_passed(bridge_deadline)) {
+		// Only reset the bus if it's our transaction that's stuck.
+		if (bridge_started) {
+			twi.abort();
+			twi.release();
+		}
+		ui.logprintln("IPMI> bridge to %X timed out", bridge_slave);
+		*data++ = IPMI_COMPLETION_TIMEOUT;
+		respond(data - tx_buffer);
+		return true;
+	}
+	if (!twi.is_complete()) return false;
+	if (!bridge_started) {
+		// Wait for Sensors to finish with the bus.
+		if (!twi.claim()) return false;
+		// Write data comes straight from the request, read
+		// data lands straight in the response.
+		twi.write_read_i2c(bridge_slave,
+						   bridge_wr_count,
+						   rx_msg + sizeof(ipmi_header_t) + 3,
+						   bridge_rd_count,
+						   data + 1);
+		bridge_started = true;
+		return false;
+	}
+	twi.release();
+	switch(__even_in_range(twi.result(), Twi::result_MAX)) {
+	case Twi::result_OK:
+		*data++ = IPMI_COMPLETION_OK;
+		data += bridge_rd_count;
+		break;
+	case Twi::result_NACK:
+		*data++ = IPMI_COMPLETION_NAK_ON_WRITE;
+		break;
+	case Twi::result_ARBITRATION_LOST:
+		*data++ = IPMI_COMPLETION_LOST_ARBITRATION;
+		break;
+	case Twi::result_TIMEOUT:
+		*data++ = IPMI_COMPLETION_TIMEOUT;
+		break;
+	default:
+		__never_executed();
+	}
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief OEM Get IPMB Statistics.
+//<
+//< Returns every counter, 16 bits LSB first, in ipmi_stats_t
+//< order. Request data of 0x01 clears them after reading.
+bool IPMI::handle_get_ipmb_stats() {
+	unsigned char *data;
+	unsigned int *counter;
+	unsigned char clear;
+	unsigned char i;
+
+	if (rx_msg_length - IPMI_MIN_MESSAGE_LENGTH) clear = rx_msg[sizeof(ipmi_header_t)];
+	else clear = 0;
+	ui.logprintln("IPMI> GET_IPMB_STATS %u", clear);
+	if (clear > 1) return respond_completion(IPMI_COMPLETION_INVALID_DATA_FIELD);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	counter = (unsigned int *) &stats;
+	for (i=0;i<NUM_STATS;i++) {
+		*data++ = counter[i] & 0xFF;
+		*data++ = counter[i] >> 8;
+		if (clear) counter[i] = 0;
+	}
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief OEM Get Latency Histogram.
+//<
+//< Request is a selector: 0-3 for a phase (Latency::latency_phase_t),
+//< 0x10 + n for the n'th per-command histogram, or 0xFF to clear
+//< everything, then optionally the first bucket (default 0). Returns
+//< netFn and cmd (0xFF and the phase for phases) then as many buckets
+//< as fit in a message, 16 bits LSB first, straight from FRAM. A
+//< whole histogram doesn't fit in 32 bytes: read the rest by asking
+//< again from the first bucket not returned.
+bool IPMI::handle_get_latency_histogram() {
+	unsigned char *data;
+	unsigned char selector;
+	unsigned char first;
+	unsigned char count;
+	const Latency::latency_histogram_t *h;
+
+	selector = rx_msg[sizeof(ipmi_header_t)];
+	if (rx_msg_length - IPMI_MIN_MESSAGE_LENGTH > 1) first = rx_msg[sizeof(ipmi_header_t)+1];
+	else first = 0;
+	ui.logprintln("IPMI> GET_LATENCY_HISTOGRAM %X %u", selector, first);
+	if (selector == 0xFF) {
+		latency.clear();
+		return respond_completion(IPMI_COMPLETION_OK);
+	}
+	if (first >= latency.LATENCY_BUCKETS) return respond_completion(IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	if (selector < latency.LATENCY_PHASES) {
+		*data++ = 0xFF;
+		*data++ = selector;
+		h = &latency.data.phase[selector];
+	} else if (selector >= 0x10 && selector < 0x10 + latency.LATENCY_COMMANDS) {
+		selector -= 0x10;
+		if (latency.data.command_key[selector][0] == 0xFF)
+			return respond_completion(IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT);
+		*data++ = latency.data.command_key[selector][0];
+		*data++ = latency.data.command_key[selector][1];
+		h = &latency.data.command[selector];
+	} else {
+		return respond_completion(IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE);
+	}
+	// 3 bytes for completion code, netFn and cmd.
+	count = (tx_message_max() - IPMI_MIN_MESSAGE_LENGTH - 3)/sizeof(unsigned int);
+	if (count > latency.LATENCY_BUCKETS - first) count = latency.LATENCY_BUCKETS - first;
+	respond_segmented(data - tx_buffer, (const unsigned char *) &h->bucket[first], count*sizeof(unsigned int));
+	return true;
+}
+
+//< \brief OEM Get All Sensor Readings.
+//<
+//< Request is an optional first sensor number, then an optional
+//< bitmap of the sensors wanted. The response packs as many
+//< sensors as fit in one message, and says where to continue.
+bool IPMI::handle_get_all_sensor_readings() {
+	unsigned char *data;
+	unsigned char *rqdata;
+	unsigned char len;
+	unsigned char first;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	len = rx_msg_length - IPMI_MIN_MESSAGE_LENGTH;
+	first = len ? rqdata[0] : 0;
+	ui.logprintln("IPMI> GET_ALL_SENSOR_READINGS %u %u", first, len);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	data = thisDevice.copy_sensor_readings(first,
+										   (len > 1) ? rqdata + 1 : 0,
+										   (len > 1) ? len - 1 : 0,
+										   data,
+										   TX_BUFFER_MAX - IPMI_MIN_MESSAGE_LENGTH);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief OEM Get Sensor Table Entry.
+//<
+//< Request is the slot, offset and count. Like Read FRU Data, the
+//< entry's bytes go out straight from FRAM.
+bool IPMI::handle_get_sensor_table_entry() {
+	unsigned char *data;
+	unsigned char *rqdata;
+	const unsigned char *body;
+	unsigned char body_length;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	ui.logprintln("IPMI> GET_SENSOR_TABLE_ENTRY %u %u %u", rqdata[0], rqdata[1], rqdata[2]);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	data = thisDevice.copy_sensor_table_entry(rqdata[0], rqdata[1], rqdata[2], data, &body, &body_length);
+	respond_segmented(data - tx_buffer, body, body_length);
+	return true;
+}
+
+//< \brief OEM Set Sensor Table Entry.
+//<
+//< Request is the slot and offset, then the bytes to write.
+bool IPMI::handle_set_sensor_table_entry() {
+	unsigned char *data;
+	unsigned char *rqdata;
+	unsigned char count;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	count = rx_msg_length - IPMI_MIN_MESSAGE_LENGTH - 2;
+	ui.logprintln("IPMI> SET_SENSOR_TABLE_ENTRY %u %u %u", rqdata[0], rqdata[1], count);
+	data = tx_buffer + sizeof(ipmi_header_t);
+	data = thisDevice.write_sensor_table_entry(rqdata[0], rqdata[1], rqdata + 2, count, data);
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Set Event Receiver.
+bool IPMI::handle_set_event_receiver() {
+	unsigned char *rqdata;
+
+	rqdata = rx_msg + sizeof(ipmi_header_t);
+	event_receiver = rqdata[0];
+	event_receiver_lun = rqdata[1] & 0x3;
+	ui.logprintln("IPMI> SET_EVENT_RECEIVER %X %u", event_receiver, event_receiver_lun);
+	// Event messages enabled/disabled is in the sensor reading state.
+	thisDevice.encode_sensor_readings();
+	return respond_completion(IPMI_COMPLETION_OK);
+}
+
+//< \brief Get Event Receiver.
+bool IPMI::handle_get_event_receiver() {
+	unsigned char *data;
+
+	ui.logputln("IPMI> GET_EVENT_RECEIVER");
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = IPMI_COMPLETION_OK;
+	*data++ = event_receiver;
+	*data++ = event_receiver_lun;
+	respond(data - tx_buffer);
+	return true;
+}
+
+//< \brief Respond with just a completion code.
+bool IPMI::respond_completion(unsigned char completion) {
+	unsigned char *data;
+
+	data = tx_buffer + sizeof(ipmi_header_t);
+	*data++ = completion;
+	respond(data - tx_buffer);
+	return true;
+}
+
+bool IPMI::handle_unknown_netfn() {
+	stats.unknown_commands++;
+	return respond_completion(IPMI_COMPLETION_INVALID);
+}
+
+/*
+ * Command registry.
+ *
+ * Each netFn we handle has a dense table of commands covering
+ * [base, base+count), indexed directly by (cmd - base). Entries
+ * are generated at compile time from ipmi_command_def<netFn, cmd>:
+ * a command is registered by specializing it with
+ * IPMI_REGISTER_COMMAND(netFn, cmd, min, max, handler), where
+ * min/max are the allowed request data lengths (not including the
+ * header or check2). Anything not registered falls back to the
+ * generic template, which rejects it with Invalid Command.
+ *
+ * Lengths are checked before the handler is called, so handlers
+ * can assume their request data is all there.
+ *
+ * Commands are in latency class class_FAST unless registered with
+ * IPMI_REGISTER_COMMAND_CLASS(netFn, cmd, min, max, class, handler).
+ *
+ * To add a command: write the handler, register it below, and
+ * make sure the table for its netFn covers the command number.
+ */
+template<unsigned char NETFN, unsigned char CMD>
+struct ipmi_command_def {
+	enum { min_length = 0, max_length = 0xFF, latency_class = IPMI::class_FAST };
+	static bool handle() { return IPMI::handle_unknown_netfn(); }
+};
+
+#define IPMI_REGISTER_COMMAND_CLASS(netfn, cmd, minlen, maxlen, cls, fn)		\
+	template<> struct ipmi_command_def<netfn, cmd> {							\
+		enum { min_length = minlen, max_length = maxlen, latency_class = cls };	\
+		typedef char length_check[((minlen) <= (maxlen)) ? 1 : -1];				\
+		static bool handle() { return fn(); }									\
+	}
+#define IPMI_REGISTER_COMMAND(netfn, cmd, minlen, maxlen, fn)		\
+	IPMI_REGISTER_COMMAND_CLASS(netfn, cmd, minlen, maxlen, IPMI::class_FAST, fn)
+
+#define IPMI_COMMAND_ENTRY(netfn, cmd)									\
+	{ netfn, cmd, ipmi_command_def<netfn, cmd>::min_length,			\
+	  ipmi_command_def<netfn, cmd>::max_length,							\
+	  ipmi_command_def<netfn, cmd>::latency_class,						\
+	  &ipmi_command_def<netfn, cmd>::handle }
+#define IPMI_COMMAND_ROW4(netfn, base)										\
+	IPMI_COMMAND_ENTRY(netfn, (base)+0), IPMI_COMMAND_ENTRY(netfn, (base)+1),	\
+	IPMI_COMMAND_ENTRY(netfn, (base)+2), IPMI_COMMAND_ENTRY(netfn, (base)+3)
+#define IPMI_COMMAND_ROW16(netfn, base)											\
+	IPMI_COMMAND_ROW4(netfn, (base)+0), IPMI_COMMAND_ROW4(netfn, (base)+4),		\
+	IPMI_COMMAND_ROW4(netfn, (base)+8), IPMI_COMMAND_ROW4(netfn, (base)+12)
+
+// App netFn (0x06).
+IPMI_REGISTER_COMMAND(0x06, 0x01, 0, 0, IPMI::handle_get_device_id);
+IPMI_REGISTER_COMMAND(0x06, 0x04, 0, 0, IPMI::handle_get_self_test_results);
+IPMI_REGISTER_COMMAND_CLASS(0x06, 0x52, 3, 0xFF, IPMI::class_BRIDGED, IPMI::handle_master_write_read);
+
+// Sensor/Event netFn (0x04).
+IPMI_REGISTER_COMMAND(0x04, 0x00, 2, 2, IPMI::handle_set_event_receiver);
+IPMI_REGISTER_COMMAND(0x04, 0x01, 0, 0, IPMI::handle_get_event_receiver);
+IPMI_REGISTER_COMMAND(0x04, 0x20, 0, 1, IPMI::handle_get_device_sdr_info);
+IPMI_REGISTER_COMMAND(0x04, 0x21, 6, 6, IPMI::handle_get_device_sdr);
+IPMI_REGISTER_COMMAND(0x04, 0x22, 0, 0, IPMI::handle_reserve_device_sdr_repository);
+IPMI_REGISTER_COMMAND(0x04, 0x24, 4, 4, IPMI::handle_set_sensor_hysteresis);
+IPMI_REGISTER_COMMAND(0x04, 0x25, 2, 2, IPMI::handle_get_sensor_hysteresis);
+IPMI_REGISTER_COMMAND(0x04, 0x26, 8, 8, IPMI::handle_set_sensor_threshold);
+IPMI_REGISTER_COMMAND(0x04, 0x27, 1, 1, IPMI::handle_get_sensor_threshold);
+IPMI_REGISTER_COMMAND(0x04, 0x2D, 1, 1, IPMI::handle_get_sensor_reading);
+
+// OEM netFn (0x30).
+IPMI_REGISTER_COMMAND(0x30, 0x00, 0, 1, IPMI::handle_get_ipmb_stats);
+IPMI_REGISTER_COMMAND(0x30, 0x01, 1, 2, IPMI::handle_get_latency_histogram);
+IPMI_REGISTER_COMMAND(0x30, 0x02, 0, 5, IPMI::handle_get_all_sensor_readings);
+IPMI_REGISTER_COMMAND(0x30, 0x03, 3, 3, IPMI::handle_get_sensor_table_entry);
+IPMI_REGISTER_COMMAND(0x30, 0x04, 3, 0xFF, IPMI::handle_set_sensor_table_entry);
+
+// Storage netFn (0x0A).
+IPMI_REGISTER_COMMAND(0x0A, 0x10, 1, 1, IPMI::handle_get_fru_inventory_area_info);
+IPMI_REGISTER_COMMAND(0x0A, 0x11, 4, 4, IPMI::handle_read_fru_data);
+IPMI_REGISTER_COMMAND(0x0A, 0x12, 4, 0xFF, IPMI::handle_write_fru_data);
+IPMI_REGISTER_COMMAND(0x0A, 0x40, 0, 0, IPMI::handle_get_sel_info);
+IPMI_REGISTER_COMMAND(0x0A, 0x42, 0, 0, IPMI::handle_reserve_sel);
+IPMI_REGISTER_COMMAND(0x0A, 0x43, 6, 6, IPMI::handle_get_sel_entry);
+IPMI_REGISTER_COMMAND(0x0A, 0x44, 16, 16, IPMI::handle_add_sel_entry);
+IPMI_REGISTER_COMMAND(0x0A, 0x47, 6, 6, IPMI::handle_clear_sel);
+
+// Sensor/Event: 0x00-0x2F.
+const IPMI::ipmi_command_t sensor_commands[] = {
+		IPMI_COMMAND_ROW16(0x04, 0x00),
+		IPMI_COMMAND_ROW16(0x04, 0x10),
+		IPMI_COMMAND_ROW16(0x04, 0x20)
+};
+// App: 0x00-0x5F.
+const IPMI::ipmi_command_t app_commands[] = {
+		IPMI_COMMAND_ROW16(0x06, 0x00),
+		IPMI_COMMAND_ROW16(0x06, 0x10),
+		IPMI_COMMAND_ROW16(0x06, 0x20),
+		IPMI_COMMAND_ROW16(0x06, 0x30),
+		IPMI_COMMAND_ROW16(0x06, 0x40),
+		IPMI_COMMAND_ROW16(0x06, 0x50)
+};
+// Storage: 0x10-0x4F (FRU, SDR repository, SEL).
+const IPMI::ipmi_command_t storage_commands[] = {
+		IPMI_COMMAND_ROW16(0x0A, 0x10),
+		IPMI_COMMAND_ROW16(0x0A, 0x20),
+		IPMI_COMMAND_ROW16(0x0A, 0x30),
+		IPMI_COMMAND_ROW16(0x0A, 0x40)
+};
+// OEM: 0x00-0x0F.
+const IPMI::ipmi_command_t oem_commands[] = {
+		IPMI_COMMAND_ROW16(0x30, 0x00)
+};
+
+#define IPMI_NETFN_TABLE(base, table) \
+	{ base, sizeof(table)/sizeof(IPMI::ipmi_command_t), table }
+
+const IPMI::ipmi_netfn_table_t sensor_netfn = IPMI_NETFN_TABLE(0x00, sensor_commands);
+const IPMI::ipmi_netfn_table_t app_netfn = IPMI_NETFN_TABLE(0x00, app_commands);
+const IPMI::ipmi_netfn_table_t storage_netfn = IPMI_NETFN_TABLE(0x10, storage_commands);
+const IPMI::ipmi_netfn_table_t oem_netfn = IPMI_NETFN_TABLE(0x00, oem_commands);
+
+//< \brief Look up and run the handler for a request.
+//<
+//< Request data length is validated against the registry
+//< before the handler ever sees it.
+bool IPMI::handle_netfn(const ipmi_netfn_table_t *table) {
+	const ipmi_command_t *command;
+	unsigned char idx;
+	unsigned char len;
+
+	idx = ((ipmi_header_t *) rx_msg)->cmd - table->base;
+	if (idx >= table->count) return handle_unknown_netfn();
+	command = &table->commands[idx];
+	len = rx_msg_length - IPMI_MIN_MESSAGE_LENGTH;
+	if (len < command->min_length || len > command->max_length)
+		return respond_completion(IPMI_COMPLETION_REQUEST_DATA_LENGTH_INVALID);
+	rx_class = command->latency_class;
+	if (node_busy(rx_class)) return respond_node_busy();
+	return command->handler();
+}
+
+//< \brief Would the request being handled go over its class's budget?
+//<
+//< It would if too many requests are queued, or if the time it's
+//< already waited plus the estimated service time is over.
+bool IPMI::node_busy(unsigned char latency_class) {
+	const ipmi_latency_budget_t *budget;
+	unsigned int age;
+
+	budget = &latency_budget[latency_class];
+	if (rx_slots_used > budget->depth) return true;
+	if ((unsigned char) (clock.ticks - rx_slot_ticks[rx_slot_rd]) >= STALL_TICKS) return true;
+	age = Clock::timestamp() - rx_stop_time;
+	if (age >= budget->service) return true;
+	return (budget->service - age < service_estimate[latency_class]);
+}
+
+//< \brief Respond with Node Busy.
+//<
+//< Not kept in the response cache: a retry should get a real answer.
+bool IPMI::respond_node_busy() {
+	ipmi_header_t *rq;
+
+	rq = (ipmi_header_t *) rx_msg;
+	ui.logprintln("IPMI> busy %X/%X from %X", rq->netfn_dstLUN, rq->cmd, rq->srcSA);
+	stats.node_busy++;
+	rx_busy = true;
+	respond_completion(IPMI_COMPLETION_NODE_BUSY);
+	response_cache[(response_cache_wr ? response_cache_wr : RESPONSE_CACHE_ENTRIES) - 1].length = 0;
+	return true;
+}
+
+//< \brief Fold the response just sent into its class's service time estimate.
+//<
+//< A moving average (1/8 weight), from start of handling to the end
+//< of transmit. Node Busy responses say nothing about service time.
+void IPMI::update_service_estimate() {
+	unsigned int sample;
+
+	if (rx_busy) return;
+	sample = tx_done_time - handle_time;
+	service_estimate[rx_class] += ((int) (sample - service_estimate[rx_class])) >> 3;
+}
+
+bool IPMI::handle_message() {
+	ipmi_header_t *p;
+	unsigned char netfn;
+	unsigned char lun;
+
+	p = (ipmi_header_t *) rx_msg;
+	netfn = (p->netfn_dstLUN & 0xFC) >> 2;
+	lun = (p->netfn_dstLUN & 0x3);
+	if (netfn & 0x1) {
+		// A response to one of our requests.
+		return handle_response();
+	}
+	// Requester resending something we already answered?
+	if (respond_cached()) return true;
+	if (lun) {
+		return handle_unknown_netfn();
+	}
+	switch (__even_in_range(netfn, 0x3E)) {
+	case 0x04:
+		return handle_netfn(&sensor_netfn);
+	case 0x06:
+		return handle_netfn(&app_netfn);
+	case 0x0A:
+		return handle_netfn(&storage_netfn);
+	case 0x30:
+		return handle_netfn(&oem_netfn);
+	case 0x00:
+	case 0x02:
+	case 0x08:
+	case 0x0C:
+	case 0x0E:
+	case 0x10:
+	case 0x12:
+	case 0x14:
+	case 0x16:
+	case 0x18:
+	case 0x1A:
+	case 0x1C:
+	case 0x1E:
+	case 0x20:
+	case 0x22:
+	case 0x24:
+	case 0x26:
+	case 0x28:
+	case 0x2A:
+	case 0x2C:
+	case 0x2E:
+	case 0x32:
+	case 0x34:
+	case 0x36:
+	case 0x38:
+	case 0x3A:
+	case 0x3C:
+	case 0x3E:
+		return handle_unknown_netfn();
+	default:
+		__never_executed();
+	}
+}
+
+bool IPMI::validate_message(unsigned char len) {
+	unsigned char check;
+	ipmi_header_t *p;
+	unsigned char *data;
+	unsigned char *p2;
+
+	if (len < IPMI_MIN_MESSAGE_LENGTH) return false;
+	p = (ipmi_header_t *) rx_msg;
+	data = rx_msg + sizeof(ipmi_header_t);
+	check = info.ipmi_address + p->netfn_dstLUN + p->check1;
+	if (check) {
+		// HACK TO SUPPORT GE BMC's BROADCAST MODE
+		// GE's BMC screws up the transmit pointer when
+		// doing broadcast mode, so it ends up overwriting
+		// the netFn/LUN with the check of the first two
+		// bytes (0 and rsSA).
+		// Then rqSA gets duplicated (again, due to pointer screwup).
+		if (len > IPMI_MIN_MESSAGE_LENGTH) goto check1_failed;
+
+		check = info.ipmi_address + p->netfn_dstLUN;
+		if (check) goto check1_failed;
+		if (p->check1 != p->srcSA) goto check1_failed;
+		check = p->check1 + p->srcSA + p->rqSeq_srcLUN + p->cmd + *data;
+		if (check) goto check1_failed;
+		// OK, it's fine. Fix the screwup.
+		stats.ge_fixups++;
+		p->netfn_dstLUN = 0x18;
+		return true;
+check1_failed:
+		stats.check1_errors++;
+		return false;
+	}
+	check = p->srcSA + p->rqSeq_srcLUN + p->cmd;
+	// Get pointer to end of data. Add 1 because
+	// IPMI_MIN_MESSAGE_LENGTH includes the check2 byte.
+	// So if the message length is 6, this is
+	// data + 6 - 6 + 1, or data + 1 (check byte).
+	p2 = data + len - IPMI_MIN_MESSAGE_LENGTH + 1;
+	do {
+		check += *data++;
+	} while (data != p2);
+	if (check) {
+		stats.check2_errors++;
+		return false;
+	}
+	return true;
+}
+
+//< \brief Queue a request to another IPMB device.
+//<
+//< The message is built right away (we're the requester, at LUN 0).
+//< Returns false if the queue is full or the message is too long.
+bool IPMI::queue_request(unsigned char rsSA,
+						 unsigned char netfn_rsLUN,
+						 unsigned char cmd,
+						 const unsigned char *data,
+						 unsigned char len) {
+	ipmi_outbound_t *slot;
+	ipmi_header_t *hdr;
+	unsigned char *p;
+	unsigned char tmp;
+	unsigned char i;
+
+	if (outbound_count == OUTBOUND_SLOTS) return false;
+	if (sizeof(ipmi_header_t) + len + 1 > sizeof(slot->data)) return false;
+	i = outbound_rd + outbound_count;
+	if (i >= OUTBOUND_SLOTS) i -= OUTBOUND_SLOTS;
+	slot = &outbound[i];
+	hdr = (ipmi_header_t *) slot->data;
+	hdr->netfn_dstLUN = netfn_rsLUN;
+	tmp = 0;
+	tmp -= rsSA;
+	tmp -= netfn_rsLUN;
+	hdr->check1 = tmp;
+	hdr->srcSA = info.ipmi_address;
+	hdr->rqSeq_srcLUN = rq_seq << 2;
+	rq_seq = (rq_seq + 1) & 0x3F;
+	hdr->cmd = cmd;
+	tmp = 0;
+	tmp -= hdr->srcSA;
+	tmp -= hdr->rqSeq_srcLUN;
+	tmp -= cmd;
+	p = slot->data + sizeof(ipmi_header_t);
+	for (i=0;i<len;i++) {
+		tmp -= data[i];
+		*p++ = data[i];
+	}
+	*p++ = tmp;
+	slot->length = p - slot->data;
+	slot->slave = rsSA;
+	slot->retry_count = 0;
+	outbound_count++;
+	// Make sure we get around to it.
+	asm("	mov.b	#0x00, r4");
+	return true;
+}
+
+//< \brief Send a request and have handler called with the response.
+//<
+//< Returns false (and handler is never called) if there's no room
+//< for it, either in the outbound queue or among outstanding requests.
+bool IPMI::send_request(unsigned char rsSA,
+						unsigned char netfn_rsLUN,
+						unsigned char cmd,
+						const unsigned char *data,
+						unsigned char len,
+						ipmi_response_handler_t handler) {
+	ipmi_pending_request_t *entry;
+	unsigned char i;
+
+	for (i=0;i<PENDING_REQUESTS;i++) {
+		if (!pending[i].handler) break;
+	}
+	if (i == PENDING_REQUESTS) return false;
+	entry = &pending[i];
+	// queue_request() uses (and advances) rq_seq.
+	entry->rq_seq = rq_seq;
+	if (!queue_request(rsSA, netfn_rsLUN, cmd, data, len)) return false;
+	entry->slave = rsSA;
+	entry->netfn_rsLUN = netfn_rsLUN;
+	entry->cmd = cmd;
+	entry->deadline = clock.ticks + REQUEST_TIMEOUT_TICKS;
+	entry->handler = handler;
+	pending_count++;
+	return true;
+}
+
+//< \brief Route a response to the request waiting for it.
+//<
+//< Responses nobody is waiting for (late, or duplicates) are dropped.
+//< Always returns false: there's nothing to send back.
+bool IPMI::handle_response() {
+	ipmi_header_t *rsp;
+	ipmi_pending_request_t *entry;
+	ipmi_response_handler_t handler;
+	unsigned char i;
+
+	rsp = (ipmi_header_t *) rx_msg;
+	// Every response has a completion code.
+	if (rx_msg_length < IPMI_MIN_RESPONSE_LENGTH) return false;
+	entry = pending;
+	for (i=0;i<PENDING_REQUESTS;i++,entry++) {
+		if (!entry->handler) continue;
+		if (entry->slave != rsp->srcSA) continue;
+		if (entry->rq_seq != (rsp->rqSeq_srcLUN >> 2)) continue;
+		if ((entry->netfn_rsLUN & 0xFC) + 0x4 != (rsp->netfn_dstLUN & 0xFC)) continue;
+		if (entry->cmd != rsp->cmd) continue;
+		handler = entry->handler;
+		entry->handler = 0;
+		pending_count--;
+		handler(rx_msg[sizeof(ipmi_header_t)],
+				rx_msg + sizeof(ipmi_header_t) + 1,
+				rx_msg_length - IPMI_MIN_RESPONSE_LENGTH);
+		return false;
+	}
+	ui.logprintln("IPMI> unmatched response %X/%X from %X", rsp->netfn_dstLUN, rsp->cmd, rsp->srcSA);
+	return false;
+}
+
+//< \brief Time out requests whose responses never came.
+void IPMI::pending_timeouts() {
+	ipmi_pending_request_t *entry;
+	ipmi_response_handler_t handler;
+	unsigned char i;
+
+	entry = pending;
+	for (i=0;i<PENDING_REQUESTS;i++,entry++) {
+		if (!entry->handler) continue;
+		if (!clock.time_has_passed(entry->deadline)) continue;
+		ui.logprintln("IPMI> request %X/%X to %X timed out", entry->netfn_rsLUN, entry->cmd, entry->slave);
+		stats.request_timeouts++;
+		handler = entry->handler;
+		entry->handler = 0;
+		pending_count--;
+		handler(IPMI_COMPLETION_TIMEOUT, 0, 0);
+	}
+}
+
+//< \brief Queue a Platform Event Message to the event receiver.
+bool IPMI::send_platform_event(unsigned char sensor_type,
+							   unsigned char sensor_number,
+							   unsigned char event_dir_type,
+							   unsigned char data1,
+							   unsigned char data2,
+							   unsigned char data3) {
+	unsigned char msg[7];
+
+	// Event Message revision: IPMI v1.5/2.0.
+	msg[0] = 0x04;
+	msg[1] = sensor_type;
+	msg[2] = sensor_number;
+	msg[3] = event_dir_type;
+	msg[4] = data1;
+	msg[5] = data2;
+	msg[6] = data3;
+	// Always logged locally, even with no event receiver.
+	sel.add_system_event(msg);
+	if (event_receiver == 0xFF) return false;
+	if (!queue_request(event_receiver,
+					   (IPMI_NETFN_SENSOR << 2) | event_receiver_lun,
+					   IPMI_SENSOR_PLATFORM_EVENT,
+					   msg, sizeof(msg))) {
+		ui.logprintln("IPMI> event %u dropped", sensor_number);
+		return false;
+	}
+	return true;
+}
+
+//< \brief Begin transmitting the request at the head of the outbound queue.
+void IPMI::start_outbound() {
+	ipmi_outbound_t *slot;
+
+	slot = &outbound[outbound_rd];
+	tx_slave = slot->slave;
+	tx_address = slot->data;
+	tx_length = slot->length;
+	tx_body_length = 0;
+	tx_retry_count = slot->retry_count;
+	ipmi_tx_state = ipmi_TX_STARTED;
+}
+
+//< \brief Done with the request at the head of the outbound queue.
+void IPMI::release_outbound() {
+	if (++outbound_rd == OUTBOUND_SLOTS) outbound_rd = 0;
+	outbound_count--;
+	ipmi_process_state = ipmi_PROCESS_IDLE;
+	if (outbound_count) asm("	mov.b	#0x00, r4");
+}
+
+bool IPMI::tx_process() {
+	unsigned int cur_tick;
+	unsigned int window;
+	unsigned char i;
+
+	switch(__even_in_range(ipmi_tx_state, ipmi_TX_STATE_MAX)) {
+	case ipmi_TX_IDLE: return false;
+	case ipmi_TX_STARTED:
+ipmi_TX_STARTED_process:
+		if (tx_length == 0) {
+			ui.logputln("IPMI> zero length msg??");
+			ipmi_tx_state = ipmi_TX_IDLE;
+			return false;
+		}
+		// Don't pull the eUSCI out from under a message
+		// we're receiving: wait for it to finish.
+		__disable_interrupt();
+		if (ipmi_rx_state == ipmi_RX_RECEIVING || (UCB0STATW & UCBBUSY)) {
+			__enable_interrupt();
+			return true;
+		}
+		ipmi_tx_state = ipmi_TX_TRANSMITTING;
+		// TX begin. Address is in tx_address,
+		// and length is in tx_length.
+		DMA1SA = (__SFR_FARPTR) (unsigned long) tx_address;
+		DMA1DA = (__SFR_FARPTR) (unsigned long) &UCB0TXBUF;
+		DMA1SZ = tx_length;
+		DMACTL0 = (19 << 8) | (DMACTL0 & 0xFF);
+		if (tx_body_length) {
+			// Segmented: the DMA interrupt chains the body and check2.
+			tx_segment = 1;
+			DMA1CTL = DMALEVEL | DMASRCBYTE | DMADSTBYTE | DMASRCINCR_3 | DMADSTINCR_0 | DMADT_0 | DMAIE;
+		} else {
+			tx_segment = 0;
+			DMA1CTL = DMALEVEL | DMASRCBYTE | DMADSTBYTE | DMASRCINCR_3 | DMADSTINCR_0 | DMADT_0;
+		}
+		// Put eUSCI_B0 in reset, switch to master mode and transmit mode.
+		// Own address is disabled only while we're master.
+		UCB0CTLW0 |= UCSWRST;
+		UCB0CTLW0 |= (UCMST | UCTR);
+		UCB0I2COA0 &= ~(UCOAEN | UCGCEN);
+		// Byte counter covers every segment.
+		if (tx_body_length) UCB0TBCNT = tx_length + tx_body_length + 1;
+		else UCB0TBCNT = tx_length;
+		UCB0CTLW0 &= ~UCSWRST;
+		UCB0IE = UCBCNTIFG | UCALIFG | UCNACKIFG;
+		// Issue start.
+		UCB0I2CSA = (tx_slave>>1);
+		tx_start_time = Clock::timestamp();
+		tx_start_ticks = Clock::ticks;
+		UCB0CTLW0 |= UCTXSTT;
+		// Start DMA. We need to check this!!
+		DMA1CTL |= DMAEN;
+		__enable_interrupt();
+
+		return true;
+	case ipmi_TX_ARBITRATION_LOST:
+	case ipmi_TX_NACKED:
+		// Wait for our STOP (or the winner's transaction) to finish:
+		// a reset under it can cut it short and leave the bus held.
+		if (UCB0STATW & UCBBUSY) return true;
+		ui.logprintln("IPMI> tx %u/%u fail %X", ++tx_retry_count, TX_RETRY_MAX, ipmi_tx_state);
+		if (tx_retry_count == TX_RETRY_MAX || !retry_budget_take(tx_slave)) {
+			// Abandoning attempt.
+			stats.abandoned++;
+			latency_valid = false;
+			ipmi_tx_state = ipmi_TX_COMPLETE;
+			goto ipmi_TX_COMPLETE_process;
+		}
+		// Listen again while we wait.
+		ipmi_rx_reset();
+		// Exponential backoff, with jitter.
+		window = BACKOFF_BASE;
+		for (i=1;i<tx_retry_count && window < backoff_max();i++) window <<= 1;
+		if (window > backoff_max()) window = backoff_max();
+		tx_retry_time = clock.ticks + 1 + (backoff_random() % window);
+		ipmi_tx_state = ipmi_TX_RETRY_WAIT;
+		return true;
+	case ipmi_TX_RETRY_WAIT:
+		cur_tick = clock.ticks;
+		if (cur_tick > tx_retry_time) {
+			if (cur_tick - tx_retry_time < 0x8000) {
+				ui.logprintln("IPMI> retry at %u", tx_retry_time);
+				stats.retries++;
+				ipmi_tx_state = ipmi_TX_STARTED;
+				goto ipmi_TX_STARTED_process;
+			}
+		}
+		return true;
+	case ipmi_TX_COMPLETE:
+	ipmi_TX_COMPLETE_process:
+		if (UCB0STATW & UCBBUSY) return true;
+		ipmi_tx_state = ipmi_TX_IDLE;
+		ipmi_rx_reset();
+		return false;
+	case ipmi_TX_TRANSMITTING:
+		return true;
+	default:
+		__never_executed();
+	}
+}
+
+void IPMI::process() {
+	retry_budget_refill();
+	if (pending_count) pending_timeouts();
+	switch(__even_in_range(ipmi_process_state, ipmi_PROCESS_STATE_MAX)) {
+	case ipmi_PROCESS_IDLE:
+		if (!rx_slots_used) {
+			// Nothing incoming: anything to send?
+			if (!outbound_count) return;
+			start_outbound();
+			ipmi_process_state = ipmi_PROCESS_OUTBOUND;
+			goto ipmi_PROCESS_OUTBOUND_process;
+		}
+		// We have a message to process.
+		rx_msg = rx_buffer[rx_slot_rd];
+		rx_msg_length = rx_slot_length[rx_slot_rd];
+		rx_stop_time = rx_slot_time[rx_slot_rd];
+		rx_stop_ticks = rx_slot_ticks[rx_slot_rd];
+		handle_time = Clock::timestamp();
+		handle_ticks = Clock::ticks;
+		latency_valid = true;
+		rx_class = class_FAST;
+		rx_busy = false;
+		if (!validate_message(rx_msg_length)) {
+			ipmi_rx_release();
+			return;
+		}
+		ipmi_process_state = ipmi_PROCESS_HANDLING;
+	case ipmi_PROCESS_HANDLING:
+		if (!handle_message()) {
+			ipmi_rx_release();
+			return;
+		}
+		if (ipmi_process_state != ipmi_PROCESS_TRANSMITTING) return;
+		tx_retry_count = 0;
+	case ipmi_PROCESS_TRANSMITTING:
+	ipmi_PROCESS_TRANSMITTING_process:
+		if (!tx_process()) {
+			if (latency_valid) {
+				latency.record(((ipmi_header_t *) rx_msg)->netfn_dstLUN >> 2,
+							   ((ipmi_header_t *) rx_msg)->cmd,
+							   rx_stop_time, rx_stop_ticks,
+							   handle_time, handle_ticks,
+							   tx_start_time, tx_start_ticks,
+							   tx_done_time, tx_done_ticks);
+				update_service_estimate();
+			}
+			ipmi_rx_release();
+		}
+		return;
+	case ipmi_PROCESS_OUTBOUND:
+	ipmi_PROCESS_OUTBOUND_process:
+		if (!tx_process()) {
+			release_outbound();
+			return;
+		}
+		// Don't make incoming requests wait on our retries.
+		if (ipmi_tx_state == ipmi_TX_RETRY_WAIT && rx_slots_used) {
+			outbound[outbound_rd].retry_count = tx_retry_count;
+			ipmi_tx_state = ipmi_TX_IDLE;
+			ipmi_process_state = ipmi_PROCESS_IDLE;
+			asm("	mov.b	#0x00, r4");
+		}
+		return;
+	case ipmi_PROCESS_BRIDGING:
+		// Twi wakes us up when it finishes, and the clock tick
+		// when it's time to give up.
+		if (!bridge_process()) return;
+		tx_retry_count = 0;
+		goto ipmi_PROCESS_TRANSMITTING_process;
+	default:
+		__never_executed();
+	}
+}
+
+// Cleanups from v1:
+// ipmi_address is the 8-bit address. It only gets programmed once, so a shift
+// at that point is easy. Compares happen all the time.
+// Message lengths come from DMA1SZ.
+// (We can't use the byte counter since general calls screw it up).
+//
+// Note we have to use UCB0RXBUF_L to avoid register usage.
+#pragma vector=USCI_B0_VECTOR
+__interrupt void IPMI_Handler() {
+	switch(__even_in_range(UCB0IV, 0x1E)) {
+	case 0x00: return;	// no interrupt
+	case 0x02: 			// ALIFG
+		IPMI::ipmi_tx_state = IPMI::ipmi_TX_ARBITRATION_LOST;
+		IPMI::stats.arbitration_lost++;
+		DMA1CTL &= ~DMAEN;
+		UCB0IE = 0;
+		asm("	mov.b	#0x00, r4");
+		// And wake up.
+		__bic_SR_register_on_exit(LPM0_bits);
+		return;
+	case 0x04:
+		IPMI::ipmi_tx_state = IPMI::ipmi_TX_NACKED;
+		IPMI::stats.nacks++;
+		UCB0CTLW0 |= UCTXSTP;
+		DMA1CTL &= ~DMAEN;
+		UCB0IE = 0;
+		asm("	mov.b	#0x00, r4");
+		// And wake up.
+		__bic_SR_register_on_exit(LPM0_bits);
+		return;  // NACKIFG
+	case 0x06: 			// STTIFG
+		if (IPMI::ipmi_rx_state != IPMI::ipmi_RX_IDLE) {
+			// Repeated Start. Queue what we have, if anything.
+			if (IPMI::ipmi_rx_complete()) {
+				asm("	mov.b	#0x00, r4");
+				__bic_SR_register_on_exit(LPM0_bits);
+			}
+		}
+		// Is it a general call?
+		if (UCB0STAT & UCGC) {
+			// Respond to stop, start, and receive.
+			UCB0IE = UCSTPIE | UCSTTIE | UCRXIE;
+			// State doesn't change. Don't touch DMA either
+			// until we're ready to really accept.
+			return;
+		}
+		UCB0IE = UCSTPIE | UCSTTIE;
+		// Queue full: NACK it, the requester will retry.
+		if (IPMI::rx_slots_used == IPMI::RX_SLOTS) {
+			IPMI::stats.rx_queue_full++;
+			UCB0CTLW0 |= UCTXNACK;
+			return;
+		}
+		// A message NACKed while the queue was full leaves its first
+		// byte in RXBUF with RXIFG0 set: drop it, or DMA would copy it
+		// into this slot.
+		UCB0IFG &= ~UCRXIFG0;
+		// DMA is set up so that the receiver can do it as quickly as possible.
+		DMA1CTL |= DMAEN;
+		// STPIFG will fire when the message is completely received.
+		IPMI::ipmi_rx_state = IPMI::ipmi_RX_RECEIVING;
+		return;
+	case 0x08: 			// STPIFG
+		// Received STOP. Queue message.
+		if (IPMI::ipmi_rx_state == IPMI::ipmi_RX_RECEIVING) {
+			if (IPMI::ipmi_rx_complete()) {
+				UCB0IE = UCSTTIE;
+				asm("	mov.b	#0x00, r4");
+				// And wake up.
+				__bic_SR_register_on_exit(LPM0_bits);
+				return;
+			}
+		}
+		// Otherwise, we just need to reset back to STTIFG.
+		UCB0IE = UCSTTIE;
+		return;
+	case 0x0A:			// RXIFG3
+	case 0x0C:			// TXIFG3
+	case 0x0E:			// RXIFG2
+	case 0x10:			// TXIFG2
+	case 0x12:			// RXIFG1
+	case 0x14:			// TXIFG1
+		return;
+	case 0x16:			// RXIFG0
+		// If it was a general call, we need to check our address.
+		if (UCB0STATW & UCGC) {
+			if (UCB0RXBUF_L == info.ipmi_address
+					&& IPMI::rx_slots_used != IPMI::RX_SLOTS) {
+				// Yes, it's ours. Enable start/stop interrupts, and set our state to receiving.
+				UCB0IE = UCSTPIE | UCSTTIE;
+				DMA1CTL |= DMAEN;
+				IPMI::ipmi_rx_state = IPMI::ipmi_RX_RECEIVING;
+				return;
+			}
+			UCB0STATW &= ~UCGC;
+		}
+		// Otherwise, just nacknacknack
+		UCB0CTLW0 |= UCTXNACK;
+		return;
+	case 0x18:			// TXIFG0
+		return;
+	case 0x1A:			// BCNTIFG
+		IPMI::tx_done_time = Clock::timestamp();
+		IPMI::tx_done_ticks = Clock::ticks;
+		IPMI::ipmi_tx_state = IPMI::ipmi_TX_COMPLETE;
+		UCB0CTLW0 |= UCTXSTP;
+		DMA1CTL &= ~DMAEN;
+		UCB0IE = 0;
+		asm("	mov.b	#0x00, r4");
+		// And wake up.
+		__bic_SR_register_on_exit(LPM0_bits);
+		return;
+	case 0x1C:			// SCLLOW
+		return;
+	case 0x1E:			// 9th bit.
+		return;
+	default:
+		__never_executed();
+	}
+}
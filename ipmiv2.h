@@ -1,126 +1,516 @@
-/*
- * ipmiv2.h
- *
- *  Created on: Feb 17, 2016
- *      Author: barawn
- */
-
-#ifndef IPMIV2_H_
-#define IPMIV2_H_
-
-#include <msp430.h>
-
-class IPMI {
-public:
-	// state definitions
-	typedef enum ipmi_rx_state {
-		ipmi_RX_IDLE = 0,
-		ipmi_RX_PAUSED = 2,
-		ipmi_RX_RECEIVING = 4,
-		ipmi_RX_PROCESSING = 6,
-		ipmi_RX_TRANSMITTING = 8,
-		ipmi_RX_STATE_MAX = 8
-	} ipmi_rx_state_t;
-	typedef enum ipmi_tx_state {
-		ipmi_TX_IDLE = 0,
-		ipmi_TX_STARTED = 2,
-		ipmi_TX_ARBITRATION_LOST = 4,
-		ipmi_TX_NACKED = 6,
-		ipmi_TX_COMPLETE = 8,
-		ipmi_TX_RETRY_WAIT = 10,
-		ipmi_TX_TRANSMITTING = 12,
-		ipmi_TX_STATE_MAX = 12
-	} ipmi_tx_state_t;
-	// IPMI structures
-	typedef struct ipmi_header {
-		unsigned char netfn_dstLUN;
-		unsigned char check1;
-		unsigned char srcSA;
-		unsigned char rqSeq_srcLUN;
-		unsigned char cmd;
-	} ipmi_header_t;
-
-
-	// IPMI constants
-	const unsigned char IPMI_MIN_MESSAGE_LENGTH = 6;
-	const unsigned char IPMI_MIN_RESPONSE_LENGTH = 7;
-
-	const unsigned char IPMI_COMPLETION_OK = 0x00;
-	const unsigned char IPMI_COMPLETION_INVALID = 0xC1;
-	const unsigned char IPMI_COMPLETION_REQUEST_DATA_TRUNCATED = 0xC6;
-	const unsigned char IPMI_COMPLETION_REQUEST_DATA_LENGTH_INVALID = 0xC7;
-	const unsigned char IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE = 0xC9;
-	const unsigned char IPMI_COMPLETION_CANNOT_RETURN_NUMBER_OF_BYTES = 0xCA;
-	const unsigned char IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT = 0xCB;
-	const unsigned char IPMI_COMPLETION_INVALID_DATA_FIELD = 0xCC;
-
-	const unsigned char IPMI_APP_GET_DEVICE_ID 		   = 0x01;
-	const unsigned char IPMI_APP_GET_SELF_TEST_RESULTS = 0x04;
-
-	const unsigned char IPMI_SENSOR_GET_DEVICE_SDR_INFO = 0x20;
-	const unsigned char IPMI_SENSOR_GET_DEVICE_SDR = 0x21;
-	const unsigned char IPMI_SENSOR_RESERVE_DEVICE_SDR_REPOSITORY = 0x22;
-	const unsigned char IPMI_SENSOR_GET_SENSOR_READING = 0x2D;
-
-	static void initialize();
-	static void process();
-	static bool tx_process();
-	static bool handle_message();
-
-	static bool handle_oem_netfn();
-	static bool handle_app_netfn();
-	static bool handle_sensor_netfn();
-	static bool handle_unknown_netfn();
-
-	static bool validate_message(unsigned char len);
-	static void respond(unsigned char len);
-
-	static void fill_connection_header(ipmi_header_t *hdr,
-									  unsigned char netFn_dstLUN,
-									  unsigned char rqSeq_srcLUN,
-									  unsigned char cmd);
-	static void generate_check2(ipmi_header_t *hdr, unsigned char *check2);
-
-	static ipmi_rx_state_t ipmi_rx_state;
-	static ipmi_tx_state_t ipmi_tx_state;
-
-	const unsigned int RX_BUFFER_SIZE = 128;
-	static unsigned char rx_buffer[RX_BUFFER_SIZE];
-	// This is an integer because it's copied from DMAxSZ, which is an int.
-	// It will always be 128 or less.
-	static unsigned int rx_buffer_remaining;
-
-	const unsigned char TX_RETRY_MAX = 3;
-	const unsigned char TX_BUFFER_SIZE = 32;
-	// Maximum bytes per message. The extra byte in the buffer
-	// is to allow us to do 16-bit copies.
-	const unsigned char TX_BUFFER_MAX = 31;
-	static unsigned char tx_retry_count;
-	static unsigned int tx_retry_time;
-	static unsigned char tx_slave;
-	static const unsigned char *tx_address;
-	static unsigned int tx_length;
-	static unsigned char tx_buffer[TX_BUFFER_SIZE];
-
-private:
-	static void ipmi_rx_dma_init() {
-		// DMA trigger is now UCB0RXIFG.
-		DMACTL0 = (18 << 8) | (DMACTL0 & 0xFF);
-		// Max buffer size.
-		DMA1SZ = IPMI::RX_BUFFER_SIZE;
-		DMA1SA = (__SFR_FARPTR) (unsigned long) &UCB0RXBUF;
-		DMA1DA = (__SFR_FARPTR) (unsigned long) IPMI::rx_buffer;
-		DMA1CTL = DMALEVEL | DMASRCBYTE | DMADSTBYTE | DMASRCINCR_0 | DMADSTINCR_3 | DMADT_0;
-	}
-	static void ipmi_rx_reset() {
-		ipmi_rx_state = ipmi_RX_IDLE;
-		UCB0CTLW0 |= UCSWRST;
-		UCB0I2COA0 |= UCOAEN | UCGCEN;
-		UCB0CTLW0 &= ~UCSWRST;
-		UCB0IE = UCSTTIE;
-	}
-};
-
-extern IPMI ipmi;
-
-#endif /* IPMIV2_H_ */
+/*
+ * ipmiv2.h
+ *
+ *  Created on: Feb 17, 2016
+ *      Author: barawn
+ */
+
+#ifndef IPMIV2_H_
+#define IPMIV2_H_
+
+#include <msp430.h>
+#include "clock.h"
+
+class IPMI {
+public:
+	// state definitions
+	// Receiver state. Only the ISR changes this (except at reset).
+	typedef enum ipmi_rx_state {
+		ipmi_RX_IDLE = 0,
+		ipmi_RX_RECEIVING = 2,
+		ipmi_RX_STATE_MAX = 2
+	} ipmi_rx_state_t;
+	// Processing state of the message at the head of the RX queue.
+	typedef enum ipmi_process_state {
+		ipmi_PROCESS_IDLE = 0,
+		ipmi_PROCESS_HANDLING = 2,
+		ipmi_PROCESS_TRANSMITTING = 4,
+		ipmi_PROCESS_OUTBOUND = 6,
+		ipmi_PROCESS_BRIDGING = 8,
+		ipmi_PROCESS_STATE_MAX = 8
+	} ipmi_process_state_t;
+	typedef enum ipmi_tx_state {
+		ipmi_TX_IDLE = 0,
+		ipmi_TX_STARTED = 2,
+		ipmi_TX_ARBITRATION_LOST = 4,
+		ipmi_TX_NACKED = 6,
+		ipmi_TX_COMPLETE = 8,
+		ipmi_TX_RETRY_WAIT = 10,
+		ipmi_TX_TRANSMITTING = 12,
+		ipmi_TX_STATE_MAX = 12
+	} ipmi_tx_state_t;
+	// IPMI structures
+	typedef struct ipmi_header {
+		unsigned char netfn_dstLUN;
+		unsigned char check1;
+		unsigned char srcSA;
+		unsigned char rqSeq_srcLUN;
+		unsigned char cmd;
+	} ipmi_header_t;
+	// Fixed response image.
+	// Responses which never change (Get Device ID, etc.) are
+	// stored in FRAM with header space, the data prefilled,
+	// and a partial check (raw_check) computed over cmd and data.
+	// Only the header and check2 are patched per request, and
+	// the image is then DMA'd straight out of FRAM.
+	// The image is laid out as ipmi_response_t, followed by
+	// data_length bytes (completion code first), followed by check2.
+	typedef struct ipmi_response {
+		unsigned char data_length;
+		unsigned char raw_check;
+		ipmi_header_t header;
+	} ipmi_response_t;
+
+
+	// IPMI constants
+	const unsigned char IPMI_MIN_MESSAGE_LENGTH = 6;
+	const unsigned char IPMI_MIN_RESPONSE_LENGTH = 7;
+
+	const unsigned char IPMI_COMPLETION_OK = 0x00;
+	const unsigned char IPMI_COMPLETION_LOST_ARBITRATION = 0x81;
+	const unsigned char IPMI_COMPLETION_NAK_ON_WRITE = 0x83;
+	const unsigned char IPMI_COMPLETION_NODE_BUSY = 0xC0;
+	const unsigned char IPMI_COMPLETION_INVALID = 0xC1;
+	const unsigned char IPMI_COMPLETION_TIMEOUT = 0xC3;
+	const unsigned char IPMI_COMPLETION_RESERVATION_CANCELLED = 0xC5;
+	const unsigned char IPMI_COMPLETION_REQUEST_DATA_TRUNCATED = 0xC6;
+	const unsigned char IPMI_COMPLETION_REQUEST_DATA_LENGTH_INVALID = 0xC7;
+	const unsigned char IPMI_COMPLETION_PARAMETER_OUT_OF_RANGE = 0xC9;
+	const unsigned char IPMI_COMPLETION_CANNOT_RETURN_NUMBER_OF_BYTES = 0xCA;
+	const unsigned char IPMI_COMPLETION_SENSOR_DATA_RECORD_NOT_PRESENT = 0xCB;
+	const unsigned char IPMI_COMPLETION_INVALID_DATA_FIELD = 0xCC;
+
+	const unsigned char IPMI_APP_GET_DEVICE_ID 		   = 0x01;
+	const unsigned char IPMI_APP_GET_SELF_TEST_RESULTS = 0x04;
+
+	const unsigned char IPMI_NETFN_SENSOR = 0x04;
+	const unsigned char IPMI_NETFN_APP = 0x06;
+	const unsigned char IPMI_NETFN_STORAGE = 0x0A;
+
+	const unsigned char IPMI_BMC_ADDRESS = 0x20;
+
+	const unsigned char IPMI_APP_MASTER_WRITE_READ = 0x52;
+
+	const unsigned char IPMI_OEM_GET_IPMB_STATS = 0x00;
+	const unsigned char IPMI_OEM_GET_LATENCY_HISTOGRAM = 0x01;
+	const unsigned char IPMI_OEM_GET_ALL_SENSOR_READINGS = 0x02;
+	const unsigned char IPMI_OEM_GET_SENSOR_TABLE_ENTRY = 0x03;
+	const unsigned char IPMI_OEM_SET_SENSOR_TABLE_ENTRY = 0x04;
+
+	// IPMB statistics. Each is only ever incremented (in the ISR or
+	// the main loop) and 16-bit increments are atomic, so nothing
+	// needs to be locked. They wrap.
+	typedef struct ipmi_stats {
+		unsigned int rx_frames;
+		unsigned int rx_queue_full;
+		unsigned int check1_errors;
+		unsigned int check2_errors;
+		unsigned int ge_fixups;
+		unsigned int nacks;
+		unsigned int arbitration_lost;
+		unsigned int retries;
+		unsigned int abandoned;
+		unsigned int unknown_commands;
+		unsigned int request_timeouts;
+		unsigned int node_busy;
+	} ipmi_stats_t;
+	const unsigned char NUM_STATS = sizeof(ipmi_stats_t)/sizeof(unsigned int);
+	static ipmi_stats_t stats;
+	static const char *stats_names[NUM_STATS];
+
+	const unsigned char IPMI_SENSOR_SET_EVENT_RECEIVER = 0x00;
+	const unsigned char IPMI_SENSOR_GET_EVENT_RECEIVER = 0x01;
+	const unsigned char IPMI_SENSOR_PLATFORM_EVENT = 0x02;
+	const unsigned char IPMI_SENSOR_GET_DEVICE_SDR_INFO = 0x20;
+	const unsigned char IPMI_SENSOR_GET_DEVICE_SDR = 0x21;
+	const unsigned char IPMI_SENSOR_RESERVE_DEVICE_SDR_REPOSITORY = 0x22;
+	const unsigned char IPMI_SENSOR_SET_SENSOR_HYSTERESIS = 0x24;
+	const unsigned char IPMI_SENSOR_GET_SENSOR_HYSTERESIS = 0x25;
+	const unsigned char IPMI_SENSOR_SET_SENSOR_THRESHOLD = 0x26;
+	const unsigned char IPMI_SENSOR_GET_SENSOR_THRESHOLD = 0x27;
+	const unsigned char IPMI_SENSOR_GET_SENSOR_READING = 0x2D;
+
+	const unsigned char IPMI_STORAGE_GET_FRU_INVENTORY_AREA_INFO = 0x10;
+	const unsigned char IPMI_STORAGE_READ_FRU_DATA = 0x11;
+	const unsigned char IPMI_STORAGE_WRITE_FRU_DATA = 0x12;
+	const unsigned char IPMI_STORAGE_GET_SEL_INFO = 0x40;
+	const unsigned char IPMI_STORAGE_RESERVE_SEL = 0x42;
+	const unsigned char IPMI_STORAGE_GET_SEL_ENTRY = 0x43;
+	const unsigned char IPMI_STORAGE_ADD_SEL_ENTRY = 0x44;
+	const unsigned char IPMI_STORAGE_CLEAR_SEL = 0x47;
+	const unsigned char IPMI_STORAGE_GET_SEL_TIME = 0x48;
+
+	static void initialize();
+	static void process();
+	static bool tx_process();
+	static bool handle_message();
+
+	// Latency classes. Each has a budget: how long a request may take
+	// from its STOP to the end of our response, and how many requests
+	// (itself included) may be queued when we start on it. A request
+	// that would go over either gets Node Busy straight away, so the
+	// BMC backs off rather than timing out and retrying into the
+	// overload. Service time (handling + transmit) is estimated per
+	// class from recent responses.
+	typedef enum ipmi_latency_class {
+		class_FAST = 0,			//< Answered from memory/FRAM.
+		class_BRIDGED = 1,		//< Waits on the Twi bus.
+		class_MAX = class_BRIDGED
+	} ipmi_latency_class_t;
+	typedef struct ipmi_latency_budget {
+		unsigned int service;	//< Timestamp counts. Must stay under 0x8000.
+		unsigned char depth;
+	} ipmi_latency_budget_t;
+	const unsigned char LATENCY_CLASSES = class_MAX + 1;
+	// Past this many ticks since STOP the timestamps have wrapped, but
+	// we're over every budget anyway.
+	const unsigned char STALL_TICKS = 8;
+	static const ipmi_latency_budget_t latency_budget[LATENCY_CLASSES];
+	static unsigned int service_estimate[LATENCY_CLASSES];
+	// Class of the request being handled, and whether it got Node Busy.
+	static unsigned char rx_class;
+	static bool rx_busy;
+	static bool node_busy(unsigned char latency_class);
+	static bool respond_node_busy();
+	static void update_service_estimate();
+
+	// Command registry entry. Lengths are request data
+	// lengths, not including the header or check2.
+	typedef bool (*ipmi_handler_t)();
+	typedef struct ipmi_command {
+		unsigned char netfn;
+		unsigned char cmd;
+		unsigned char min_length;
+		unsigned char max_length;
+		unsigned char latency_class;
+		ipmi_handler_t handler;
+	} ipmi_command_t;
+	// Dense table of commands for one netFn, indexed by (cmd - base).
+	typedef struct ipmi_netfn_table {
+		unsigned char base;
+		unsigned char count;
+		const ipmi_command_t *commands;
+	} ipmi_netfn_table_t;
+
+	static bool handle_netfn(const ipmi_netfn_table_t *table);
+	static bool handle_unknown_netfn();
+	static bool respond_completion(unsigned char completion);
+
+	static bool handle_get_device_id();
+	static bool handle_get_self_test_results();
+	static bool handle_get_device_sdr_info();
+	static bool handle_get_device_sdr();
+	static bool handle_reserve_device_sdr_repository();
+	static bool handle_get_sensor_reading();
+	static bool handle_set_sensor_hysteresis();
+	static bool handle_get_sensor_hysteresis();
+	static bool handle_set_sensor_threshold();
+	static bool handle_get_sensor_threshold();
+	static bool handle_get_fru_inventory_area_info();
+	static bool handle_read_fru_data();
+	static bool handle_write_fru_data();
+	static bool handle_get_sel_info();
+	static bool handle_reserve_sel();
+	static bool handle_get_sel_entry();
+	static bool handle_add_sel_entry();
+	static bool handle_clear_sel();
+	static bool handle_master_write_read();
+	static bool handle_get_ipmb_stats();
+	static bool handle_get_latency_histogram();
+	static bool handle_get_all_sensor_readings();
+	static bool handle_get_sensor_table_entry();
+	static bool handle_set_sensor_table_entry();
+	static bool handle_set_event_receiver();
+	static bool handle_get_event_receiver();
+
+	static bool validate_message(unsigned char len);
+	static void respond(unsigned char len);
+	static void respond_segmented(unsigned char len,
+								  const unsigned char *body,
+								  unsigned char body_length);
+	static unsigned char compute_body_check(const unsigned char *body,
+											unsigned char body_length);
+	static void prepare_fixed_response(ipmi_response_t *rsp);
+	static void compute_raw_check(ipmi_response_t *rsp);
+	static unsigned char fill_response_header(ipmi_header_t *rsp);
+
+	static void fill_connection_header(ipmi_header_t *hdr,
+									  unsigned char netFn_dstLUN,
+									  unsigned char rqSeq_srcLUN,
+									  unsigned char cmd);
+	static void generate_check2(ipmi_header_t *hdr, unsigned char *check2);
+
+	static ipmi_rx_state_t ipmi_rx_state;
+	static ipmi_process_state_t ipmi_process_state;
+	static ipmi_tx_state_t ipmi_tx_state;
+
+	// RX queue. Each slot holds one IPMB message: the largest legal
+	// one is 32 bytes including our own address, which isn't stored.
+	// The ISR fills slot rx_slot_wr by DMA, process() drains from
+	// rx_slot_rd. Our own address stays enabled while the queue
+	// is being processed: it's only disabled while we're master.
+	const unsigned char RX_SLOTS = 3;
+	const unsigned int RX_SLOT_SIZE = 32;
+	static unsigned char rx_buffer[RX_SLOTS][RX_SLOT_SIZE];
+	static unsigned char rx_slot_length[RX_SLOTS];
+	// Clock::timestamp() at each slot's STOP (or repeated START),
+	// and the low byte of Clock::ticks.
+	static unsigned int rx_slot_time[RX_SLOTS];
+	static unsigned char rx_slot_ticks[RX_SLOTS];
+	static unsigned char rx_slot_wr;
+	static unsigned char rx_slot_rd;
+	static volatile unsigned char rx_slots_used;
+	// Message currently being handled (head of the queue).
+	static unsigned char *rx_msg;
+	static unsigned char rx_msg_length;
+
+	const unsigned char TX_RETRY_MAX = 3;
+	const unsigned char TX_BUFFER_SIZE = 32;
+	// Maximum bytes per message. The extra byte in the buffer
+	// is to allow us to do 16-bit copies.
+	const unsigned char TX_BUFFER_MAX = 31;
+	// Maximum bytes per segmented message (header in tx_buffer,
+	// body from FRAM), see tx_message_max(). IPMB v1.0 limits
+	// messages to 32 bytes counting the slave address, which is
+	// TX_BUFFER_MAX. info.ipmi_message_max can raise that to
+	// TX_MESSAGE_LIMIT, if the BMC takes longer messages: that's
+	// a full sensor record (56 bytes), completion code and next
+	// record ID in one Get Device SDR response. Only the header is
+	// in tx_buffer, so it doesn't grow with this.
+	const unsigned char TX_MESSAGE_LIMIT = 65;
+	static unsigned char tx_message_max();
+	static unsigned char tx_retry_count;
+	static unsigned int tx_retry_time;
+	// Latency timestamps for the response being handled/sent, each
+	// with the low byte of Clock::ticks (see Latency). The byte
+	// counter ISR sets tx_done_time. latency_valid is cleared
+	// if the response is abandoned.
+	static unsigned int rx_stop_time;
+	static unsigned int handle_time;
+	static unsigned int tx_start_time;
+	static volatile unsigned int tx_done_time;
+	static unsigned char rx_stop_ticks;
+	static unsigned char handle_ticks;
+	static unsigned char tx_start_ticks;
+	static volatile unsigned char tx_done_ticks;
+	static bool latency_valid;
+	// Retry policy. After each failure we wait a random 1..window
+	// ticks, where the window starts at BACKOFF_BASE and doubles
+	// per retry up to info.ipmi_backoff_max. The randomness is
+	// seeded per-board (TLV die record), so MCs that collided
+	// don't retry in lockstep.
+	//
+	// Each destination also has a budget of retries, refilled by
+	// one per second up to info.ipmi_retry_budget: a destination
+	// that keeps failing stops getting retries until it recovers.
+	const unsigned char BACKOFF_BASE = 2;
+	const unsigned char BACKOFF_MAX_DEFAULT = 16;
+	const unsigned char RETRY_BUDGET_DEFAULT = 8;
+	const unsigned char RETRY_DESTINATIONS = 4;
+	typedef struct ipmi_retry_budget {
+		unsigned char slave;
+		unsigned char tokens;
+	} ipmi_retry_budget_t;
+	static ipmi_retry_budget_t retry_budget[RETRY_DESTINATIONS];
+	static unsigned char retry_budget_wr;
+	static unsigned int retry_refill_time;
+	static unsigned int backoff_state;
+	static void backoff_initialize();
+	static unsigned int backoff_random();
+	static unsigned char backoff_max();
+	static unsigned char retry_budget_max();
+	static bool retry_budget_take(unsigned char slave);
+	static void retry_budget_refill();
+	static unsigned char tx_slave;
+	// Either tx_buffer, a cached response, or a fixed response image in FRAM.
+	static const unsigned char *tx_address;
+	static unsigned int tx_length;
+	// Points to the response cache entry being built.
+	static unsigned char *tx_buffer;
+	// Segmented transmit: tx_length bytes from tx_address, then
+	// tx_body_length bytes from tx_body, then check2, which is at
+	// tx_address[tx_length]. tx_body_length = 0 means tx_address
+	// holds the whole message (check2 included in tx_length).
+	static const unsigned char *tx_body;
+	static unsigned char tx_body_length;
+	static volatile unsigned char tx_segment;
+	// Called from the DMA ISR when a TX segment finishes.
+	static inline void tx_dma_segment() {
+		if (tx_segment == 1) {
+			DMA1SA = (__SFR_FARPTR) (unsigned long) tx_body;
+			DMA1SZ = tx_body_length;
+			tx_segment = 2;
+			DMA1CTL |= DMAEN;
+		} else if (tx_segment == 2) {
+			DMA1SA = (__SFR_FARPTR) (unsigned long) (tx_address + tx_length);
+			DMA1SZ = 1;
+			tx_segment = 0;
+			DMA1CTL = (DMA1CTL & ~DMAIE) | DMAEN;
+		}
+	}
+
+	// Response cache. Responses built in tx_buffer are kept, keyed
+	// by the request's srcSA, rqSeq/LUN, netFn/LUN and cmd. If the
+	// requester missed our response and resends the same request,
+	// the cached bytes go back out without running the handler again
+	// (IPMB allows this, and it keeps non-idempotent commands safe).
+	// Fixed responses aren't cached: they're cheaper to just redo.
+	typedef struct ipmi_cached_response {
+		unsigned char data[TX_BUFFER_SIZE];
+		const unsigned char *body;
+		unsigned int ticks;
+		unsigned char length;	// 0 = invalid
+		unsigned char body_length;
+		unsigned char body_check;
+		unsigned char srcSA;
+		unsigned char rqSeq_srcLUN;
+		unsigned char netfn_dstLUN;
+		unsigned char cmd;
+	} ipmi_cached_response_t;
+	// One entry is always the one being built.
+	const unsigned char RESPONSE_CACHE_ENTRIES = 4;
+	// Entries expire after 2 seconds.
+	const unsigned int RESPONSE_CACHE_TICKS = 60;
+	static ipmi_cached_response_t response_cache[RESPONSE_CACHE_ENTRIES];
+	static unsigned char response_cache_wr;
+	static bool respond_cached();
+
+	// Outbound queue. Requests we originate (Platform Event Messages)
+	// wait here until there's nothing incoming to handle, and then go
+	// out through the same TX state machine as responses. If one is
+	// waiting to retry when a request comes in, it's put back and the
+	// request is handled first.
+	typedef struct ipmi_outbound {
+		unsigned char data[16];
+		unsigned char length;
+		unsigned char slave;
+		unsigned char retry_count;
+	} ipmi_outbound_t;
+	const unsigned char OUTBOUND_SLOTS = 4;
+	static ipmi_outbound_t outbound[OUTBOUND_SLOTS];
+	static unsigned char outbound_rd;
+	static unsigned char outbound_count;
+	static unsigned char rq_seq;
+	static bool queue_request(unsigned char rsSA,
+							  unsigned char netfn_rsLUN,
+							  unsigned char cmd,
+							  const unsigned char *data,
+							  unsigned char len);
+	static void start_outbound();
+	static void release_outbound();
+
+	// Outstanding requests. send_request() queues a request and
+	// remembers who's waiting for the response: the responder,
+	// netFn, cmd and rqSeq. A response matching all of them calls
+	// the handler with its completion code and data. That's done as
+	// it's received, so it never holds up requests to us: handlers
+	// are called from process() and must be quick, and the data is
+	// only valid during the call. If nothing comes back in time the
+	// handler gets IPMI_COMPLETION_TIMEOUT and no data.
+	typedef void (*ipmi_response_handler_t)(unsigned char completion,
+											const unsigned char *data,
+											unsigned char len);
+	typedef struct ipmi_pending_request {
+		ipmi_response_handler_t handler;	// 0 = free
+		unsigned int deadline;
+		unsigned char slave;
+		unsigned char netfn_rsLUN;
+		unsigned char cmd;
+		unsigned char rq_seq;
+	} ipmi_pending_request_t;
+	const unsigned char PENDING_REQUESTS = 4;
+	// Covers the outbound queue and our retries, as well as the responder.
+	const unsigned int REQUEST_TIMEOUT_TICKS = 60;
+	static ipmi_pending_request_t pending[PENDING_REQUESTS];
+	static unsigned char pending_count;
+	static bool send_request(unsigned char rsSA,
+							 unsigned char netfn_rsLUN,
+							 unsigned char cmd,
+							 const unsigned char *data,
+							 unsigned char len,
+							 ipmi_response_handler_t handler);
+	static bool handle_response();
+	static void pending_timeouts();
+
+	// Master Write-Read onto the private (Twi) bus. The handler
+	// leaves us in ipmi_PROCESS_BRIDGING, and bridge_process() starts
+	// the transaction once Twi is free and responds when it's done.
+	// Read data goes straight into the response. If it isn't done
+	// within BRIDGE_TIMEOUT_TICKS (waiting for the bus included), it's
+	// abandoned with a timeout: a slave holding SCL low would otherwise
+	// leave us bridging for good.
+	const unsigned char BRIDGE_READ_MAX = TX_BUFFER_MAX - IPMI_MIN_MESSAGE_LENGTH - 1;
+	const unsigned char BRIDGE_TIMEOUT_TICKS = 6;
+	static bool bridge_process();
+	static unsigned int bridge_deadline;
+	static bool bridge_started;
+	static unsigned char bridge_slave;
+	static unsigned char bridge_wr_count;
+	static unsigned char bridge_rd_count;
+
+	// Event receiver. 0xFF disables event generation.
+	// Resets to the BMC (0x20), per the IPMI spec.
+	static unsigned char event_receiver;
+	static unsigned char event_receiver_lun;
+	static bool send_platform_event(unsigned char sensor_type,
+									unsigned char sensor_number,
+									unsigned char event_dir_type,
+									unsigned char data1,
+									unsigned char data2,
+									unsigned char data3);
+
+	// Point the RX DMA at the current write slot. Called from the ISR
+	// after each message, so it's kept short.
+	static inline void ipmi_rx_dma_arm() {
+		DMA1DA = (__SFR_FARPTR) (unsigned long) IPMI::rx_buffer[IPMI::rx_slot_wr];
+		DMA1SZ = IPMI::RX_SLOT_SIZE;
+	}
+	// Close out a message in the ISR (STOP or repeated START).
+	// Returns true if it had data and was queued.
+	static inline bool ipmi_rx_complete() {
+		unsigned char len;
+		DMA1CTL &= ~DMAEN;
+		ipmi_rx_state = ipmi_RX_IDLE;
+		len = IPMI::RX_SLOT_SIZE - DMA1SZ;
+		if (!len) return false;
+		rx_slot_length[rx_slot_wr] = len;
+		rx_slot_time[rx_slot_wr] = Clock::timestamp();
+		rx_slot_ticks[rx_slot_wr] = Clock::ticks;
+		stats.rx_frames++;
+		if (++rx_slot_wr == IPMI::RX_SLOTS) rx_slot_wr = 0;
+		rx_slots_used++;
+		ipmi_rx_dma_arm();
+		return true;
+	}
+private:
+	static void ipmi_rx_dma_init() {
+		// DMA trigger is now UCB0RXIFG.
+		DMACTL0 = (18 << 8) | (DMACTL0 & 0xFF);
+		DMA1SA = (__SFR_FARPTR) (unsigned long) &UCB0RXBUF;
+		ipmi_rx_dma_arm();
+		DMA1CTL = DMALEVEL | DMASRCBYTE | DMADSTBYTE | DMASRCINCR_0 | DMADSTINCR_3 | DMADT_0;
+	}
+	// Return to slave receiver mode with our own address enabled.
+	static void ipmi_rx_reset() {
+		ipmi_rx_state = ipmi_RX_IDLE;
+		UCB0CTLW0 |= UCSWRST;
+		UCB0CTLW0 &= ~(UCMST | UCTR);
+		UCB0I2COA0 |= UCOAEN | UCGCEN;
+		ipmi_rx_dma_init();
+		UCB0CTLW0 &= ~UCSWRST;
+		UCB0IE = UCSTTIE;
+	}
+	// Done with the message at the head of the queue.
+	static void ipmi_rx_release() {
+		ipmi_process_state = ipmi_PROCESS_IDLE;
+		if (++rx_slot_rd == RX_SLOTS) rx_slot_rd = 0;
+		// Single instruction (dec.b), so safe against the ISR.
+		rx_slots_used--;
+		// Keep the main loop awake if there's more queued.
+		if (rx_slots_used) asm("	mov.b	#0x00, r4");
+	}
+};
+
+extern IPMI ipmi;
+
+#endif /* IPMIV2_H_ */
@@ -0,0 +1,87 @@
+#include <msp430.h>
+#include "latency.h"
+
+Latency latency;
+
+#define LATENCY_UNUSED { 0xFF, 0x00 }
+
+#pragma PERSISTENT
+Latency::latency_data_t Latency::data = {
+		.command_key = { LATENCY_UNUSED, LATENCY_UNUSED, LATENCY_UNUSED, LATENCY_UNUSED,
+						 LATENCY_UNUSED, LATENCY_UNUSED, LATENCY_UNUSED, LATENCY_UNUSED }
+};
+
+const char *Latency::phase_names[Latency::LATENCY_PHASES] = {
+		"queued",
+		"handling",
+		"transmit",
+		"total"
+};
+
+//% \brief Add one time to a histogram.
+void Latency::add(latency_histogram_t *h, unsigned int t) {
+	unsigned char b;
+
+	b = 0;
+	while (t && b < LATENCY_BUCKETS-1) {
+		t >>= 1;
+		b++;
+	}
+	if (h->bucket[b] != 0xFFFF) h->bucket[b]++;
+}
+
+//% \brief Time between two timestamps, in timestamp counts.
+//%
+//% Anything more than LONG_TICKS ticks long (which the timestamps
+//% alone can't tell from a wrap) comes back as the longest time.
+unsigned int Latency::span(unsigned int from,
+						   unsigned char from_ticks,
+						   unsigned int to,
+						   unsigned char to_ticks) {
+	if ((unsigned char) (to_ticks - from_ticks) > LONG_TICKS) return 0xFFFF;
+	return to - from;
+}
+
+//% \brief Record one request/response.
+//%
+//% Each time is a timestamp and the low byte of Clock::ticks.
+void Latency::record(unsigned char netfn,
+					 unsigned char cmd,
+					 unsigned int stop,
+					 unsigned char stop_ticks,
+					 unsigned int handle,
+					 unsigned char handle_ticks,
+					 unsigned int tx_start,
+					 unsigned char tx_start_ticks,
+					 unsigned int done,
+					 unsigned char done_ticks) {
+	unsigned int total;
+	unsigned char i;
+
+	total = span(stop, stop_ticks, done, done_ticks);
+	add(&data.phase[phase_QUEUED], span(stop, stop_ticks, handle, handle_ticks));
+	add(&data.phase[phase_HANDLING], span(handle, handle_ticks, tx_start, tx_start_ticks));
+	add(&data.phase[phase_TRANSMIT], span(tx_start, tx_start_ticks, done, done_ticks));
+	add(&data.phase[phase_TOTAL], total);
+	for (i=0;i<LATENCY_COMMANDS;i++) {
+		if (data.command_key[i][0] == netfn && data.command_key[i][1] == cmd) break;
+		if (data.command_key[i][0] == 0xFF) {
+			data.command_key[i][0] = netfn;
+			data.command_key[i][1] = cmd;
+			break;
+		}
+	}
+	if (i != LATENCY_COMMANDS) add(&data.command[i], total);
+}
+
+//% \brief Clear all histograms, and forget the commands.
+void Latency::clear() {
+	unsigned int *p;
+	unsigned char i;
+
+	p = (unsigned int *) &data.phase[0];
+	while (p != (unsigned int *) &data.phase[LATENCY_PHASES]) *p++ = 0;
+	for (i=0;i<LATENCY_COMMANDS;i++) data.command_key[i][0] = 0xFF;
+	p = (unsigned int *) &data.command[0];
+	while (p != (unsigned int *) &data.command[LATENCY_COMMANDS]) *p++ = 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * latency.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+//% \brief Request-to-response latency histograms.
+//%
+//% Times come from the free-running Timer_A (Clock::timestamp(), 8 us
+//% per count). Each request we answer is split into phases:
+//% queued (STOP to start of handling), handling (to TX start, which
+//% includes any retry backoff), transmit (TX start to the byte counter
+//% completing) and total (STOP to byte counter). Every phase gets a
+//% log2 histogram: bucket b counts times t with 2^(b-1) <= t < 2^b
+//% (bucket 0 is t = 0), and the last bucket takes everything beyond.
+//% Timestamps wrap every 524 ms, so each one comes with the low byte
+//% of Clock::ticks: a phase more than LONG_TICKS ticks long goes in
+//% the last bucket whatever its timestamp difference says.
+//% The total is also histogrammed per command, for the first
+//% LATENCY_COMMANDS distinct netFn/cmd pairs seen.
+//%
+//% The histograms are persistent (FRAM), so they survive a reset:
+//% clear them explicitly. Counts saturate rather than wrap.
+class Latency {
+public:
+	Latency() {}
+
+	const unsigned char LATENCY_BUCKETS = 16;
+	const unsigned char LATENCY_PHASES = 4;
+	const unsigned char LATENCY_COMMANDS = 8;
+	// Microseconds per timestamp count.
+	const unsigned char US_PER_COUNT = 8;
+	// More than this many ticks (133 ms at 30 ticks/s) is past the last
+	// bucket's bound (2^14 counts, 131 ms). Up to this many, a phase is
+	// under 5 ticks (167 ms), well inside one timestamp wrap.
+	const unsigned char LONG_TICKS = 4;
+
+	typedef enum latency_phase {
+		phase_QUEUED = 0,
+		phase_HANDLING = 1,
+		phase_TRANSMIT = 2,
+		phase_TOTAL = 3
+	} latency_phase_t;
+
+	typedef struct latency_histogram {
+		unsigned int bucket[LATENCY_BUCKETS];
+	} latency_histogram_t;
+
+	typedef struct latency_data {
+		latency_histogram_t phase[LATENCY_PHASES];
+		// netFn, cmd. netFn 0xFF is an unused entry.
+		unsigned char command_key[LATENCY_COMMANDS][2];
+		latency_histogram_t command[LATENCY_COMMANDS];
+	} latency_data_t;
+
+	static void record(unsigned char netfn,
+					   unsigned char cmd,
+					   unsigned int stop,
+					   unsigned char stop_ticks,
+					   unsigned int handle,
+					   unsigned char handle_ticks,
+					   unsigned int tx_start,
+					   unsigned char tx_start_ticks,
+					   unsigned int done,
+					   unsigned char done_ticks);
+	static void clear();
+	static unsigned int span(unsigned int from,
+							 unsigned char from_ticks,
+							 unsigned int to,
+							 unsigned char to_ticks);
+
+	static latency_data_t data;
+	static const char *phase_names[LATENCY_PHASES];
+private:
+	static void add(latency_histogram_t *h, unsigned int t);
+};
+
+extern Latency latency;
+
+#endif /* LATENCY_H_ */
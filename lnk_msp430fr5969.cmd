@@ -137,6 +137,7 @@ SECTIONS
            .TI.persistent : {}              /* For #pragma persistent            */
            .cio           : {}              /* C I/O Buffer                      */
            .sysmem        : {}              /* Dynamic memory allocation area    */
+           .sel           : type = NOINIT{} /* System Event Log                  */
         } PALIGN(0x0400), RUN_START(fram_rw_start)
 
         GROUP(IPENCAPSULATED_MEMORY)
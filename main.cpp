@@ -5,6 +5,7 @@
 #include "sensors.h"
 #include "ipmi_device_specific.h"
 #include "twi.h"
+#include "sel.h"
 
 unsigned char i2c_buf[2];
 
@@ -39,8 +40,10 @@ void main(void) {
 		asm("		MOV.B #0x18, r4");
 		ui.process();
 		ipmi.process();
+		thisDevice.process();
 		twi.process();
 		sensors.process();
+		sel.process();
 		asm("		OR.W r4, SR");
     	asm("		NOP");
 
@@ -0,0 +1,163 @@
+#include <msp430.h>
+#include "sel.h"
+#include "clock.h"
+#include "info.h"
+#include "ipmiv2.h"
+#include "ui.h"
+
+SEL sel;
+
+#pragma PERSISTENT
+SEL::sel_state_t SEL::state = { 1, 0, 0, 0, 0 };
+
+// Contents are only meaningful for the records counted in state.
+#pragma DATA_SECTION(".sel")
+unsigned char SEL::entries[SEL::SEL_ENTRIES][SEL::ENTRY_SIZE];
+
+unsigned long SEL::seconds = 0;
+unsigned int SEL::next_second = 0;
+unsigned int SEL::time_sync_wait = SEL::TIME_SYNC_FIRST;
+unsigned int SEL::reservation = 0;
+bool SEL::reserved = false;
+
+//% \brief Keep SEL time, and sync it with the BMC.
+void SEL::process() {
+	if (clock.time_has_passed(next_second)) {
+		seconds++;
+		next_second += clock.ticks_per_second;
+		if (time_sync_wait && !--time_sync_wait) {
+			if (!ipmi.send_request(IPMI::IPMI_BMC_ADDRESS,
+								   IPMI::IPMI_NETFN_STORAGE << 2,
+								   IPMI::IPMI_STORAGE_GET_SEL_TIME,
+								   0, 0,
+								   time_sync_response))
+				time_sync_wait = TIME_SYNC_RETRY;
+		}
+	}
+}
+
+unsigned long SEL::time() {
+	return seconds;
+}
+
+//% \brief Set SEL time (seconds, in the SEL timestamp format).
+void SEL::set_time(unsigned long t) {
+	seconds = t;
+	next_second = clock.ticks + clock.ticks_per_second;
+}
+
+//% \brief Get SEL Time response from the BMC.
+//%
+//% From then on our SEL timestamps are the BMC's time, so they can
+//% be lined up with its own log.
+void SEL::time_sync_response(unsigned char completion, const unsigned char *data, unsigned char len) {
+	unsigned long t;
+
+	if (completion != IPMI::IPMI_COMPLETION_OK || len < 4) {
+		ui.logprintln("SEL> time sync failed %X", completion);
+		time_sync_wait = TIME_SYNC_RETRY;
+		return;
+	}
+	t = data[0] + ((unsigned int) data[1] << 8) + ((unsigned long) data[2] << 16) + ((unsigned long) data[3] << 24);
+	ui.logprintln("SEL> time %n (was %n)", t, seconds);
+	set_time(t);
+	time_sync_wait = TIME_SYNC_SECONDS;
+}
+
+//% \brief ID of the most recent record (valid only if count is nonzero).
+unsigned int SEL::last_id() {
+	if (state.next_id == 1) return LAST_ID;
+	return state.next_id - 1;
+}
+
+//% \brief Append a record. Returns its record ID.
+//%
+//% The record ID (and the timestamp, for timestamped records) is
+//% filled in here.
+unsigned int SEL::add(const unsigned char *record) {
+	unsigned char *p;
+	unsigned long now;
+	unsigned int id;
+	unsigned char i;
+
+	id = state.next_id;
+	p = entries[(id - 1) & (SEL_ENTRIES - 1)];
+	now = time();
+	// If full, drop the oldest record first: it lives in the slot
+	// we're about to write.
+	if (state.count == SEL_ENTRIES) {
+		state.count--;
+		state.overflow = 1;
+	}
+	p[0] = id & 0xFF;
+	p[1] = id >> 8;
+	for (i=2;i<ENTRY_SIZE;i++) p[i] = record[i];
+	if (p[2] < OEM_NON_TIMESTAMPED) {
+		p[3] = now & 0xFF;
+		p[4] = (now >> 8) & 0xFF;
+		p[5] = (now >> 16) & 0xFF;
+		p[6] = (now >> 24) & 0xFF;
+	}
+	// Record is complete: now commit it.
+	state.next_id = (id == LAST_ID) ? 1 : id + 1;
+	state.count++;
+	state.add_time = now;
+	return id;
+}
+
+//% \brief Log one of our own events (EvMRev through event data 3).
+unsigned int SEL::add_system_event(const unsigned char *event) {
+	unsigned char record[16];
+	unsigned char i;
+
+	// System event record.
+	record[2] = 0x02;
+	// Generator ID: our IPMB address, channel 0, LUN 0.
+	record[7] = info.ipmi_address;
+	record[8] = 0x00;
+	for (i=0;i<7;i++) record[9+i] = event[i];
+	return add(record);
+}
+
+//% \brief Look up a record.
+//%
+//% 0x0000 is the first (oldest) record and 0xFFFF the last. Returns
+//% 0 if the record isn't present, otherwise the record, with the ID
+//% of the next record (0xFFFF after the last) in next_id.
+const unsigned char *SEL::entry(unsigned int id, unsigned int *next_id) {
+	unsigned int last;
+	unsigned int age;
+
+	if (!state.count) return 0;
+	last = last_id();
+	if (id == 0xFFFF) id = last;
+	else if (id == 0x0000) {
+		if (state.count - 1 >= last) id = last + LAST_ID - (state.count - 1);
+		else id = last - (state.count - 1);
+	}
+	if (id > LAST_ID) return 0;
+	age = last - id;
+	if (id > last) age += LAST_ID;
+	if (age >= state.count) return 0;
+	if (id == last) *next_id = 0xFFFF;
+	else *next_id = (id == LAST_ID) ? 1 : id + 1;
+	return entries[(id - 1) & (SEL_ENTRIES - 1)];
+}
+
+//% \brief Clear the SEL. Cancels the reservation.
+void SEL::clear() {
+	state.count = 0;
+	state.overflow = 0;
+	state.erase_time = time();
+	reserved = false;
+}
+
+unsigned int SEL::reserve() {
+	if (++reservation == 0) reservation = 1;
+	reserved = true;
+	return reservation;
+}
+
+bool SEL::reservation_valid(unsigned int id) {
+	return (reserved && id == reservation);
+}
@@ -0,0 +1,72 @@
+/*
+ * sel.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SEL_H_
+#define SEL_H_
+
+//% \brief System Event Log.
+//%
+//% The SEL is a log-structured ring of 16-byte records in FRAM (the
+//% .sel section, next to the PERSISTENT variables: below 64K for the
+//% small data model, and writable under the MPU). Record IDs run from 1 to LAST_ID and then wrap,
+//% and LAST_ID is a multiple of the ring size, so a record always lives
+//% in slot (id-1) % SEL_ENTRIES: lookups are a bounds check and an index.
+//%
+//% Adding a record writes one slot and then updates the (persistent)
+//% state, so nothing is ever erased and an interrupted add just loses
+//% that record. Clearing the SEL only resets the state. Once the ring
+//% is full the oldest record is overwritten and the overflow flag is set.
+class SEL {
+public:
+	SEL() {}
+
+	const unsigned int SEL_ENTRIES = 512;
+	const unsigned char ENTRY_SIZE = 16;
+	const unsigned int LAST_ID = 0xFE00;
+	// Record types below this have a timestamp.
+	const unsigned char OEM_NON_TIMESTAMPED = 0xE0;
+
+	typedef struct sel_state {
+		unsigned int next_id;
+		unsigned int count;
+		unsigned long add_time;
+		unsigned long erase_time;
+		unsigned char overflow;
+	} sel_state_t;
+
+	// SEL time comes from the BMC (Get SEL Time): a few seconds after
+	// startup, then hourly, or a minute after a failed attempt.
+	const unsigned int TIME_SYNC_FIRST = 5;
+	const unsigned int TIME_SYNC_SECONDS = 3600;
+	const unsigned int TIME_SYNC_RETRY = 60;
+
+	static void process();
+	//< Current SEL time: the BMC's, once synced. Until then, seconds since init (pre-init timestamp range).
+	static unsigned long time();
+	static void set_time(unsigned long t);
+	static unsigned int add(const unsigned char *record);
+	static unsigned int add_system_event(const unsigned char *event);
+	static const unsigned char *entry(unsigned int id, unsigned int *next_id);
+	static void clear();
+	static unsigned int reserve();
+	static bool reservation_valid(unsigned int id);
+
+	static sel_state_t state;
+private:
+	static unsigned char entries[SEL_ENTRIES][ENTRY_SIZE];
+	static unsigned long seconds;
+	static unsigned int next_second;
+	// Seconds until the next time sync. 0 while one is outstanding.
+	static unsigned int time_sync_wait;
+	static void time_sync_response(unsigned char completion, const unsigned char *data, unsigned char len);
+	static unsigned int reservation;
+	static bool reserved;
+	static unsigned int last_id();
+};
+
+extern SEL sel;
+
+#endif /* SEL_H_ */